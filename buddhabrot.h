@@ -0,0 +1,270 @@
+#ifndef BUDDHABROT_H
+#define BUDDHABROT_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "./mandelbrot_set.h"
+#include "./unrolled_matrix.h"
+#include "util/parallel.hpp"
+#include "util/timer.hpp"
+
+// orbit density (Buddhabrot) of z^2 + c: orbits of escaping c are traced and every point they visit is counted in the
+// pixel it falls in, using the view mapping of MandelbrotSet. view.iteration is the longest orbit kept
+//
+// every chunk of samples has its own random generator and its own density grid, so the hot loop writes nothing shared
+// (orbits pile up on the brightest pixels, shared adds would contend right there). the grids are allocated once per
+// view and merged into the density at the end of every addSamples() call, which leaves them zeroed for the next one.
+// starting points are drawn from cells of [-2, 2]^2 weighted by how many probe points of the cell escape within
+// [getMinIteration(), view.iteration), each sample is weighted by 1 / its probability so the density converges to the
+// same image as uniform sampling. cells without any escaping probe are never sampled
+//
+// addSamples() can be called repeatedly (e.g. once per frame), the density keeps accumulating until reset()
+template <typename T = double>
+class Buddhabrot
+{
+public:
+    using Value_type       = T;
+    using Cell_type        = std::complex<Value_type>;
+    using ViewParams       = typename MandelbrotSet<Value_type>::ViewParams;
+    using Pixel_type       = std::array<unsigned char, 4>;
+    using Density_type     = float;
+    using DensityData_type = UnrolledMatrix<Density_type>;
+
+    struct Settings
+    {
+        std::size_t   minIteration{ 20 };    // shorter orbits are dropped, they only blur the image. capped by getMinIteration()
+        std::size_t   samplingCells{ 256 };  // cells per side of the importance map
+        std::size_t   probesPerCell{ 4 };    // per side, probe points of each cell when building the map
+        std::uint64_t seed{ 0x5eed };
+    };
+
+private:
+    // importance map: cumulative weight of every cell and the weight each sample of the cell gets
+    struct SamplingCell
+    {
+        std::size_t  index;
+        double       cumulative;
+        Density_type sampleWeight;
+    };
+
+    ViewParams                                     m_view{};
+    Settings                                       m_settings{};
+    DensityData_type                               m_density{};
+    std::vector<SamplingCell>                      m_cells{};
+    std::vector<util::AlignedVector<Density_type>> m_chunkDensity{};    // per chunk of samples, zero between calls
+    std::size_t                                    m_sampleCount{};
+    std::uint64_t                                  m_batch{};           // addSamples() calls, part of the seeds
+
+public:
+    Buddhabrot(const ViewParams& view, const Settings& settings = {})
+    {
+        reset(view, settings);
+    }
+
+    // start over, the importance map is only rebuilt when the orbit parameters change
+    void reset(const ViewParams& view, const Settings& settings)
+    {
+        const bool rebuild{ m_cells.empty() || view.iteration != m_view.iteration || view.radius != m_view.radius
+                            || settings.minIteration != m_settings.minIteration || settings.samplingCells != m_settings.samplingCells
+                            || settings.probesPerCell != m_settings.probesPerCell };
+
+        m_view     = view;
+        m_settings = settings;
+        m_density.resize(view.width, view.height);
+        m_density.map([](Density_type) { return Density_type{ 0 }; });
+        m_chunkDensity.assign(util::defaultChunkNumber(), util::AlignedVector<Density_type>(view.getLength(), 0));
+        m_sampleCount = 0;
+        m_batch       = 0;
+
+        if (rebuild)
+            buildSamplingCells();
+    }
+
+    void reset(const ViewParams& view) { reset(view, m_settings); }
+
+    // trace count more orbits and add them to the density
+    void addSamples(std::size_t count)
+    {
+        util::Timer timer{ "addSamples" };
+
+        if (m_cells.empty())
+            return;
+
+        const std::uint64_t batch{ m_batch++ };
+        util::parallelChunks(count, m_chunkDensity.size(), [this, batch](std::size_t i, std::size_t startSample, std::size_t endSample) {
+            std::mt19937_64 random{ m_settings.seed ^ (batch * 0x9e3779b97f4a7c15ull) ^ (i * 0xbf58476d1ce4e5b9ull) };
+            traceOrbits(random, endSample - startSample, m_chunkDensity[i]);
+        });
+
+        // merge the chunk grids, split over pixels this time, and clear them for the next call in the same pass
+        util::parallelChunks(m_view.getLength(), [this](std::size_t, std::size_t startPos, std::size_t endPos) {
+            auto& density{ m_density.base() };
+            for (auto& chunk : m_chunkDensity) {
+                for (std::size_t pos{ startPos }; pos < endPos; ++pos) {
+                    density[pos] += chunk[pos];
+                    chunk[pos]    = 0;
+                }
+            }
+        });
+
+        m_sampleCount += count;
+    }
+
+    // density mapped to grayscale with a square root curve, normalized to the densest pixel. pixels holds
+    // view.width * view.height elements
+    void toImage(std::span<Pixel_type> pixels) const
+    {
+        const Density_type maxDensity{ m_density.reduce(Density_type{ 0 }, [](Density_type d) { return d; }, [](Density_type a, Density_type b) {
+            return std::max(a, b);
+        }) };
+        const Density_type scale{ maxDensity > 0 ? 1 / std::sqrt(maxDensity) : 0 };
+
+        util::parallelChunks(m_view.getLength(), [this, pixels, scale](std::size_t, std::size_t startPos, std::size_t endPos) {
+            for (std::size_t pos{ startPos }; pos < endPos; ++pos) {
+                const auto v{ static_cast<unsigned char>(0xff * std::sqrt(m_density.base()[pos]) * scale) };
+                pixels[pos] = { v, v, v, 0xff };
+            }
+        });
+    }
+
+    const ViewParams&       getView() const { return m_view; }
+    const Settings&         getSettings() const { return m_settings; }
+    const DensityData_type& getDensity() const { return m_density; }
+    std::size_t             getSampleCount() const { return m_sampleCount; }
+
+    // the view's iteration limit goes down with the zoom (about 16 at the default view), a fixed minIteration above it
+    // would drop every orbit. at most a quarter of the limit keeps the long orbits that carry the picture
+    std::size_t getMinIteration() const { return std::min(m_settings.minIteration, m_view.iteration / 4); }
+
+private:
+    static constexpr Value_type s_samplingExtent{ 4.0 };    // the map covers [-2, 2]^2, which contains the whole set
+
+    // escape iteration of c, iteration itself when it doesn't escape. the main cardioid and the period-2 bulb are
+    // rejected without iterating
+    std::size_t escapeTime(const Cell_type& c) const
+    {
+        const Value_type x{ c.real() };
+        const Value_type y{ c.imag() };
+        const Value_type q{ (x - 0.25) * (x - 0.25) + y * y };
+        if (q * (q + (x - 0.25)) <= 0.25 * y * y || (x + 1) * (x + 1) + y * y <= 0.0625)
+            return m_view.iteration;
+
+        const Value_type squareRadius{ m_view.radius * m_view.radius };
+        Value_type       zr{ 0 };
+        Value_type       zi{ 0 };
+        for (std::size_t i{ 0 }; i < m_view.iteration; ++i) {
+            const Value_type zr2{ zr * zr };
+            const Value_type zi2{ zi * zi };
+            if (zr2 + zi2 > squareRadius)
+                return i;
+            zi = 2 * zr * zi + y;
+            zr = zr2 - zi2 + x;
+        }
+        return m_view.iteration;
+    }
+
+    bool isContributing(std::size_t escape) const
+    {
+        return escape >= getMinIteration() && escape < m_view.iteration;
+    }
+
+    void buildSamplingCells()
+    {
+        util::Timer timer{ "buildSamplingCells" };
+
+        const std::size_t   cells{ m_settings.samplingCells };
+        const std::size_t   probes{ m_settings.probesPerCell };
+        const Value_type    cellSize{ s_samplingExtent / static_cast<Value_type>(cells) };
+        std::vector<double> weights(cells * cells, 0.0);
+
+        util::parallelChunks(cells * cells, [&](std::size_t, std::size_t startCell, std::size_t endCell) {
+            for (std::size_t cell{ startCell }; cell < endCell; ++cell) {
+                const Cell_type corner{ getCellCorner(cell) };
+                std::size_t     hits{ 0 };
+                for (std::size_t py{ 0 }; py < probes; ++py) {
+                    for (std::size_t px{ 0 }; px < probes; ++px) {
+                        const Cell_type offset{ (px + 0.5) * cellSize / probes, (py + 0.5) * cellSize / probes };
+                        hits += isContributing(escapeTime(corner + offset));
+                    }
+                }
+                // a little weight for every cell with a hit so thin filaments between the probes are still sampled
+                weights[cell] = hits > 0 ? static_cast<double>(hits) + 0.5 : 0.0;
+            }
+        });
+
+        double total{ 0.0 };
+        for (const auto weight : weights)
+            total += weight;
+
+        // uniform sampling over the whole area would give every cell 1 / cells^2, the sample weight is the ratio of that
+        // to the cell's actual probability weight / total
+        m_cells.clear();
+        double cumulative{ 0.0 };
+        for (std::size_t cell{ 0 }; cell < weights.size(); ++cell) {
+            if (weights[cell] > 0.0) {
+                cumulative += weights[cell];
+                const double sampleWeight{ total / (weights[cell] * static_cast<double>(cells * cells)) };
+                m_cells.push_back({ cell, cumulative, static_cast<Density_type>(sampleWeight) });
+            }
+        }
+    }
+
+    Cell_type getCellCorner(std::size_t cell) const
+    {
+        const std::size_t cells{ m_settings.samplingCells };
+        const Value_type  cellSize{ s_samplingExtent / static_cast<Value_type>(cells) };
+        return { static_cast<Value_type>(cell % cells) * cellSize - 2, static_cast<Value_type>(cell / cells) * cellSize - 2 };
+    }
+
+    template <typename Random>
+    void traceOrbits(Random& random, std::size_t count, std::span<Density_type> density) const
+    {
+        const std::size_t cells{ m_settings.samplingCells };
+        const Value_type  cellSize{ s_samplingExtent / static_cast<Value_type>(cells) };
+        const double      total{ m_cells.back().cumulative };
+        const Value_type  delta{ m_view.getDelta() };
+        const Cell_type   origin{ m_view.getOrigin() };
+        const auto        width{ static_cast<Value_type>(m_view.width) };
+        const auto        height{ static_cast<Value_type>(m_view.height) };
+
+        std::uniform_real_distribution<double>     pick{ 0.0, total };
+        std::uniform_real_distribution<Value_type> unit{ 0.0, 1.0 };
+
+        for (std::size_t sample{ 0 }; sample < count; ++sample) {
+            const double target{ pick(random) };
+            const auto   cell{ std::upper_bound(m_cells.begin(), m_cells.end(), target, [](double value, const SamplingCell& cell) {
+                return value < cell.cumulative;
+            }) };
+            const auto&  chosen{ cell == m_cells.end() ? m_cells.back() : *cell };
+
+            const Cell_type c{ getCellCorner(chosen.index) + Cell_type{ unit(random) * cellSize, unit(random) * cellSize } };
+            if (!isContributing(escapeTime(c)))
+                continue;
+
+            // second pass over the (known to escape) orbit, splatting every point that lands in the view
+            Value_type zr{ 0 };
+            Value_type zi{ 0 };
+            for (std::size_t i{ 0 }; i < m_view.iteration; ++i) {
+                const Value_type nextReal{ zr * zr - zi * zi + c.real() };
+                zi = 2 * zr * zi + c.imag();
+                zr = nextReal;
+
+                const Value_type x{ (zr - origin.real()) / delta };
+                const Value_type y{ (zi - origin.imag()) / delta };
+                if (x >= 0 && y >= 0 && x < width && y < height)
+                    density[static_cast<std::size_t>(y) * m_view.width + static_cast<std::size_t>(x)] += chosen.sampleWeight;
+                else if (zr * zr + zi * zi > m_view.radius * m_view.radius)
+                    break;
+            }
+        }
+    }
+};
+
+#endif /* ifndef BUDDHABROT_H */
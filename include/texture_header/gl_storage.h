@@ -0,0 +1,64 @@
+#ifndef GL_STORAGE_H
+#define GL_STORAGE_H
+
+#include <glad/glad.h>
+
+#include <cstring>
+
+// immutable texture storage (GL 4.2 / ARB_texture_storage) and buffer storage (GL 4.4 / ARB_buffer_storage) are above
+// the 3.3 core glad is generated for, so their entry points are loaded here. Mesa's software GL exposes both
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#    define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#    define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+namespace glStorage
+{
+    using TexStorage2D_type  = void(APIENTRYP)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
+    using BufferStorage_type = void(APIENTRYP)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+    inline TexStorage2D_type  texStorage2D{};
+    inline BufferStorage_type bufferStorage{};
+
+    inline bool hasExtension(const char* name)
+    {
+        GLint count{};
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i{ 0 }; i < count; ++i) {
+            auto* extension{ reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i)) };
+            if (extension && std::strcmp(extension, name) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    inline bool hasVersion(int major, int minor)
+    {
+        GLint contextMajor{};
+        GLint contextMinor{};
+        glGetIntegerv(GL_MAJOR_VERSION, &contextMajor);
+        glGetIntegerv(GL_MINOR_VERSION, &contextMinor);
+        return contextMajor > major || (contextMajor == major && contextMinor >= minor);
+    }
+
+    inline bool isSupported()
+    {
+        return texStorage2D && bufferStorage;
+    }
+
+    // call once with a current context, returns whether persistent mapping into immutable textures is usable
+    inline bool load(GLADloadproc loader)
+    {
+        if (hasVersion(4, 2) || hasExtension("GL_ARB_texture_storage"))
+            texStorage2D = reinterpret_cast<TexStorage2D_type>(loader("glTexStorage2D"));
+        if (hasVersion(4, 4) || hasExtension("GL_ARB_buffer_storage"))
+            bufferStorage = reinterpret_cast<BufferStorage_type>(loader("glBufferStorage"));
+
+        return isSupported();
+    }
+}
+
+#endif
@@ -6,9 +6,14 @@
 #include <stb/stb_image.h>
 
 #include <iostream>
+#include <cstdint>
 #include <limits>
+#include <span>
+#include <utility>
 
+#include "util/rect.hpp"
 #include "util/timer.hpp"
+#include "texture_header/gl_storage.h"
 
 
 class Texture
@@ -29,6 +34,8 @@ private:
     GL_texture_filter_type minFilter{};
     GL_texture_filter_type wrapFilter{};
 
+    bool autoMipmap{ true };    // regenerate the mipmaps after every update
+
 public:
     static inline constexpr unsigned int maxUnitNum{ std::numeric_limits<unsigned int>::max() };
 
@@ -107,6 +114,19 @@ public:
         imageData = nullptr;
     }
 
+    // exchange the GL textures (and the shapes of their images) of two objects, the texture units stay. e.g. to keep
+    // drawing the old image while this object is respecified for a new one
+    void swapTexture(Texture& other)
+    {
+        std::swap(textureID, other.textureID);
+        std::swap(imageWidth, other.imageWidth);
+        std::swap(imageHeight, other.imageHeight);
+        std::swap(nrChannels, other.nrChannels);
+    }
+
+    // a texture drawn at (about) its own size never samples the mipmaps, there is no need to rebuild them every update
+    void setMipmapGeneration(bool enable) { autoMipmap = enable; }
+
     void updateTexture(unsigned char* data, int width, int height, int numChannels=3)
     {
         util::Timer timer{ "updateTexture" };
@@ -116,8 +136,78 @@ public:
         if (numChannels > 3)
             format = GL_RGBA;
 
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        // only reallocate the storage when the image changes shape
+        if (width != imageWidth || height != imageHeight || numChannels != nrChannels) {
+            glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+            imageWidth  = width;
+            imageHeight = height;
+            nrChannels  = numChannels;
+        } else {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, data);
+        }
+
+        if (autoMipmap)
+            glGenerateMipmap(GL_TEXTURE_2D);
+    }
+
+    // upload only the given regions of a width x height RGBA image, data points at the whole image
+    void updateTextureRegions(const unsigned char* data, int width, int height, std::span<const util::Rect> regions)
+    {
+        util::Timer timer{ "updateTextureRegions" };
+        uploadRegions(data, width, height, regions, 4, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE);
+    }
+
+    // single channel 16-bit normalized image (GL_R16), for raw values a shader interprets itself
+    void updateTextureRegions(const std::uint16_t* data, int width, int height, std::span<const util::Rect> regions)
+    {
+        util::Timer timer{ "updateTextureRegions (R16)" };
+        uploadRegions(data, width, height, regions, 1, GL_R16, GL_RED, GL_UNSIGNED_SHORT);
+    }
+
+    // immutable RGBA8 storage with a single level (see gl_storage.h), allocated once per size so that frames only replace
+    // the contents. immutable textures can't be respecified, a new texture object with the same parameters replaces the
+    // old one
+    void allocateStorage(int width, int height)
+    {
+        GLint params[4]{ GL_LINEAR, GL_NEAREST, GL_REPEAT, GL_REPEAT };
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, &params[0]);
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, &params[1]);
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, &params[2]);
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, &params[3]);
+        glDeleteTextures(1, &textureID);
+
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glStorage::texStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+
+        // there is only one level, mipmapped minification would sample nothing
+        if (params[0] != GL_NEAREST && params[0] != GL_LINEAR)
+            params[0] = GL_LINEAR;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, params[0]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, params[1]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, params[2]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, params[3]);
+
+        imageWidth  = width;
+        imageHeight = height;
+        nrChannels  = 4;
+    }
+
+    // replace the contents of the storage from a pixel unpack buffer holding a whole width x height RGBA image, only the
+    // given regions are copied. the copy happens on the GPU side
+    void updateTextureFromBuffer(unsigned int pixelBuffer, int width, [[maybe_unused]] int height, std::span<const util::Rect> regions)
+    {
+        util::Timer timer{ "updateTextureFromBuffer" };
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+        for (const auto& region : regions) {
+            const auto offset{ static_cast<std::uintptr_t>((region.y * width + region.x) * 4) };
+            glTexSubImage2D(GL_TEXTURE_2D, 0, region.x, region.y, region.width, region.height, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<const void*>(offset));
+        }
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
     }
 
     void updateMagFilter(GL_texture_filter_type magFilter)
@@ -149,6 +239,32 @@ public:
     }
 
 private:
+    // (re)allocates the storage when the image changes shape or format, then only the regions are copied either way: the
+    // rest of data may not have been written yet (an incremental render uploads its bands as they finish)
+    template <typename Channel_type>
+    void uploadRegions(const Channel_type* data, int width, int height, std::span<const util::Rect> regions, int channels, GLenum internalFormat, GLenum format, GLenum type)
+    {
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, channels * sizeof(Channel_type) % 4 == 0 ? 4 : static_cast<int>(sizeof(Channel_type)));
+
+        if (width != imageWidth || height != imageHeight || nrChannels != channels) {
+            glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+            imageWidth  = width;
+            imageHeight = height;
+            nrChannels  = channels;
+        }
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+        for (const auto& region : regions) {
+            const auto* regionData{ data + (region.y * width + region.x) * channels };
+            glTexSubImage2D(GL_TEXTURE_2D, 0, region.x, region.y, region.width, region.height, format, type, regionData);
+        }
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        if (autoMipmap)
+            glGenerateMipmap(GL_TEXTURE_2D);
+    }
+
     // TODO: make a generateTexture() function that accepts parameters of texture wrap, texture min filter, and texture mag filter.
     void generateTexture(int minFilter=GL_LINEAR, int magFilter=GL_NEAREST, int wrap=GL_REPEAT)
     {
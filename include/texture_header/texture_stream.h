@@ -0,0 +1,125 @@
+#ifndef TEXTURE_STREAM_H
+#define TEXTURE_STREAM_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <iostream>
+#include <span>
+#include <vector>
+
+#include "texture_header/gl_storage.h"
+#include "texture_header/texture.h"
+#include "util/rect.hpp"
+#include "util/timer.hpp"
+
+// ring of persistently mapped pixel unpack buffers feeding a texture with immutable storage. the producer writes a
+// frame straight into the mapped memory returned by acquire(), commit() copies it into the texture on the GPU and fences
+// the buffer so that it isn't written again before that copy is done. the mapping is readable too (the engine copies
+// mirrored rows within the frame), but reads of it are uncached: whole image passes belong in ordinary memory
+//
+// requires glStorage::load() to have succeeded
+class TextureStream
+{
+public:
+    static constexpr int         s_channels{ 4 };    // RGBA8
+    static constexpr std::size_t s_defaultRingSize{ 3 };
+
+private:
+    struct Slot
+    {
+        unsigned int   buffer{};
+        unsigned char* data{};
+        GLsync         fence{};
+    };
+
+    std::vector<Slot> m_slots{};
+    std::size_t       m_current{ 0 };
+
+    int m_width{};
+    int m_height{};
+
+public:
+    TextureStream(int width, int height, std::size_t ringSize = s_defaultRingSize)
+        : m_slots(ringSize)
+    {
+        resize(width, height);
+    }
+
+    TextureStream(const TextureStream&)            = delete;
+    TextureStream& operator=(const TextureStream&) = delete;
+
+    ~TextureStream()
+    {
+        deleteBuffers();
+    }
+
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+
+    // reallocates the buffers, the texture has to be given new storage with Texture::allocateStorage as well
+    void resize(int width, int height)
+    {
+        if (width == m_width && height == m_height)
+            return;
+
+        deleteBuffers();
+        m_width  = width;
+        m_height = height;
+
+        const auto       size{ static_cast<GLsizeiptr>(width) * height * s_channels };
+        const GLbitfield flags{ GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT };
+        for (auto& slot : m_slots) {
+            glGenBuffers(1, &slot.buffer);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+            glStorage::bufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags);
+            slot.data = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags));
+            if (!slot.data)
+                std::cerr << "Failed to map pixel buffer " << slot.buffer << '\n';
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        m_current = 0;
+    }
+
+    // mapped memory of the next free buffer (width * height RGBA8 pixels), waits until the GPU has consumed it. nullptr
+    // when the buffer couldn't be mapped, the caller uploads another way then
+    unsigned char* acquire()
+    {
+        Slot& slot{ m_slots[m_current] };
+        if (slot.fence) {
+            util::Timer timer{ "TextureStream fence wait" };
+            while (glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000'000) == GL_TIMEOUT_EXPIRED) { }
+            glDeleteSync(slot.fence);
+            slot.fence = nullptr;
+        }
+        return slot.data;
+    }
+
+    // upload the regions written into the buffer returned by the last acquire() and move on to the next buffer. the rest
+    // of the buffer holds an older frame and must not be uploaded
+    void commit(Texture& texture, std::span<const util::Rect> regions)
+    {
+        Slot& slot{ m_slots[m_current] };
+        texture.updateTextureFromBuffer(slot.buffer, m_width, m_height, regions);
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        m_current  = (m_current + 1) % m_slots.size();
+    }
+
+private:
+    void deleteBuffers()
+    {
+        for (auto& slot : m_slots) {
+            if (slot.fence)
+                glDeleteSync(slot.fence);
+            if (slot.buffer) {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                glDeleteBuffers(1, &slot.buffer);
+            }
+            slot = {};
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+};
+
+#endif
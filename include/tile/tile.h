@@ -80,6 +80,12 @@ public:
     Plane& getPlane() { return m_plane; }
 
     void draw()
+    {
+        draw(m_texture);
+    }
+
+    // draw with another texture in place of m_texture
+    void draw(const Texture& texture)
     {
         m_shader.use();
 
@@ -87,9 +93,9 @@ public:
         m_shader.setVec3("color", m_color);
 
         // set texture
-        m_shader.setInt("tex", m_texture.textureUnitNum);
-        glActiveTexture(GL_TEXTURE0 + m_texture.textureUnitNum);
-        glBindTexture(GL_TEXTURE_2D, m_texture.textureID);
+        m_shader.setInt("tex", texture.textureUnitNum);
+        glActiveTexture(GL_TEXTURE0 + texture.textureUnitNum);
+        glBindTexture(GL_TEXTURE_2D, texture.textureID);
 
         // draw
         m_plane.draw();
@@ -0,0 +1,105 @@
+#ifndef ALIGNED_ALLOCATOR_HPP
+#define ALIGNED_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#    include <sys/mman.h>
+#endif
+
+// storage for image sized buffers: cache line aligned so the kernels can use aligned SIMD loads, transparent huge pages
+// for the large ones, and elements that are default-initialized (left as is for trivial types) instead of zero-filled.
+// users only read what they wrote: a full render writes every pixel before the image is used, an incremental one
+// (MandelbrotSet::generateStep) reports the bands it finished and only those are uploaded
+
+namespace util::memory
+{
+    inline constexpr std::size_t s_cacheLineSize{ 64 };
+    inline constexpr std::size_t s_hugePageSize{ 2 * 1024 * 1024 };
+
+    namespace detail
+    {
+        inline bool g_hugePages{ true };
+    }
+
+    inline bool isHugePagesEnabled() { return detail::g_hugePages; }
+
+    // only affects buffers allocated afterwards
+    inline void setHugePages(bool enable) { detail::g_hugePages = enable; }
+
+    inline void* allocate(std::size_t size, std::size_t alignment)
+    {
+        const bool huge{ isHugePagesEnabled() && size >= s_hugePageSize };
+        if (huge)
+            alignment = s_hugePageSize;
+
+        // aligned_alloc wants a multiple of the alignment, free() doesn't care which alignment was asked for
+        const std::size_t rounded{ (size + alignment - 1) / alignment * alignment };
+        void*             ptr{ std::aligned_alloc(alignment, rounded) };
+        if (!ptr)
+            throw std::bad_alloc{};
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+        if (huge)
+            ::madvise(ptr, rounded, MADV_HUGEPAGE);    // only a hint, fine if the kernel says no
+#endif
+        return ptr;
+    }
+
+    inline void deallocate(void* ptr) { std::free(ptr); }
+}
+
+namespace util
+{
+    template <typename T, std::size_t Alignment = memory::s_cacheLineSize>
+    class AlignedAllocator
+    {
+    public:
+        using value_type      = T;
+        using is_always_equal = std::true_type;
+
+        static constexpr std::size_t s_alignment{ Alignment > alignof(T) ? Alignment : alignof(T) };
+
+        template <typename U>
+        struct rebind
+        {
+            using other = AlignedAllocator<U, Alignment>;
+        };
+
+        AlignedAllocator() = default;
+
+        template <typename U>
+        AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept
+        {
+        }
+
+        T* allocate(std::size_t n) { return static_cast<T*>(memory::allocate(n * sizeof(T), s_alignment)); }
+        void deallocate(T* ptr, std::size_t) { memory::deallocate(ptr); }
+
+        // no arguments means default-initialization, not the value-initialization std::allocator does
+        template <typename U, typename... Args>
+        void construct(U* ptr, Args&&... args)
+        {
+            if constexpr (sizeof...(Args) == 0)
+                ::new (static_cast<void*>(ptr)) U;
+            else
+                ::new (static_cast<void*>(ptr)) U(std::forward<Args>(args)...);
+        }
+
+        template <typename U>
+        bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept
+        {
+            return true;
+        }
+    };
+
+    template <typename T>
+    using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+}
+
+#endif /* ifndef ALIGNED_ALLOCATOR_HPP */
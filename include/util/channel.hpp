@@ -0,0 +1,109 @@
+#ifndef CHANNEL_HPP
+#define CHANNEL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace util
+{
+    // bounded multi-producer multi-consumer queue. push blocks while capacity values are waiting (backpressure: a slow
+    // consumer holds the producer back instead of letting the queue grow), pop blocks while it is empty. close() wakes
+    // everyone up: pushes fail from then on, pops drain what is left and then return nothing
+    template <typename T>
+    class Channel
+    {
+    private:
+        mutable std::mutex      m_mutex;
+        std::condition_variable m_notEmpty;
+        std::condition_variable m_notFull;
+        std::deque<T>           m_queue;
+        std::size_t             m_capacity;
+        bool                    m_closed{ false };
+
+    public:
+        explicit Channel(std::size_t capacity = 1)
+            : m_capacity{ capacity > 0 ? capacity : 1 }
+        {
+        }
+
+        Channel(const Channel&)            = delete;
+        Channel& operator=(const Channel&) = delete;
+
+        // false when the channel was closed, value is dropped
+        bool push(T value)
+        {
+            std::unique_lock lock{ m_mutex };
+            m_notFull.wait(lock, [this] { return m_closed || m_queue.size() < m_capacity; });
+            if (m_closed)
+                return false;
+
+            m_queue.push_back(std::move(value));
+            lock.unlock();
+            m_notEmpty.notify_one();
+            return true;
+        }
+
+        // false when the channel is full or closed, value is dropped then (for producers that must not wait)
+        bool tryPush(T value)
+        {
+            std::unique_lock lock{ m_mutex };
+            if (m_closed || m_queue.size() >= m_capacity)
+                return false;
+
+            m_queue.push_back(std::move(value));
+            lock.unlock();
+            m_notEmpty.notify_one();
+            return true;
+        }
+
+        // nothing once the channel is closed and empty
+        std::optional<T> pop()
+        {
+            std::unique_lock lock{ m_mutex };
+            m_notEmpty.wait(lock, [this] { return m_closed || !m_queue.empty(); });
+            return take(lock);
+        }
+
+        // nothing when no value is waiting
+        std::optional<T> tryPop()
+        {
+            std::unique_lock lock{ m_mutex };
+            return take(lock);
+        }
+
+        void close()
+        {
+            {
+                std::lock_guard lock{ m_mutex };
+                m_closed = true;
+            }
+            m_notEmpty.notify_all();
+            m_notFull.notify_all();
+        }
+
+        bool isClosed() const
+        {
+            std::lock_guard lock{ m_mutex };
+            return m_closed;
+        }
+
+    private:
+        std::optional<T> take(std::unique_lock<std::mutex>& lock)
+        {
+            if (m_queue.empty())
+                return std::nullopt;
+
+            std::optional<T> value{ std::move(m_queue.front()) };
+            m_queue.pop_front();
+            lock.unlock();
+            m_notFull.notify_one();
+            return value;
+        }
+    };
+}
+
+#endif /* ifndef CHANNEL_HPP */
@@ -0,0 +1,93 @@
+#ifndef CPU_FEATURES_HPP
+#define CPU_FEATURES_HPP
+
+#include <array>
+#include <cstdlib>
+#include <optional>
+#include <string_view>
+
+// instruction sets the kernels are compiled for. every variant is built into the binary through function target
+// attributes, the best one the host supports is picked at startup
+//
+// override with the MANDELBROT_ISA environment variable or util::cpu::setIsa() (see --isa in main.cpp)
+
+// ISA-specific function variants need GCC/Clang target attributes on x86
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#    define UTIL_CPU_ISA_VARIANTS
+#endif
+
+namespace util::cpu
+{
+    enum class Isa
+    {
+        generic,    // whatever the build flags give (SSE2 on x86-64)
+        avx2,       // AVX2 + FMA
+        avx512,     // AVX-512F/DQ with 512-bit vectors preferred
+    };
+
+    inline constexpr std::array<std::string_view, 3> s_isaNames{ "generic", "avx2", "avx512" };
+
+    inline std::string_view getName(Isa isa)
+    {
+        return s_isaNames[static_cast<std::size_t>(isa)];
+    }
+
+    inline std::optional<Isa> parseIsa(std::string_view name)
+    {
+        for (std::size_t i{ 0 }; i < s_isaNames.size(); ++i) {
+            if (s_isaNames[i] == name)
+                return static_cast<Isa>(i);
+        }
+        return std::nullopt;
+    }
+
+    inline bool isSupported(Isa isa)
+    {
+#ifdef UTIL_CPU_ISA_VARIANTS
+        switch (isa) {
+        case Isa::generic: return true;
+        case Isa::avx2: return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        case Isa::avx512: return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq");
+        }
+        return false;
+#else
+        return isa == Isa::generic;
+#endif
+    }
+
+    inline Isa detectIsa()
+    {
+        for (auto isa : { Isa::avx512, Isa::avx2 }) {
+            if (isSupported(isa))
+                return isa;
+        }
+        return Isa::generic;
+    }
+
+    namespace detail
+    {
+        inline Isa initialIsa()
+        {
+            if (const char* env{ std::getenv("MANDELBROT_ISA") }) {
+                if (auto isa{ parseIsa(env) }; isa && isSupported(*isa))
+                    return *isa;
+            }
+            return detectIsa();
+        }
+
+        inline Isa g_activeIsa{ initialIsa() };
+    }
+
+    inline Isa getIsa() { return detail::g_activeIsa; }
+
+    // returns false (and keeps the current one) when the host can't run the requested instruction set
+    inline bool setIsa(Isa isa)
+    {
+        if (!isSupported(isa))
+            return false;
+        detail::g_activeIsa = isa;
+        return true;
+    }
+}
+
+#endif /* ifndef CPU_FEATURES_HPP */
@@ -0,0 +1,146 @@
+#ifndef NUMA_HPP
+#define NUMA_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#    include <sched.h>
+#endif
+
+// NUMA placement without libnuma: the node -> cpu map comes from sysfs, threads are pinned with their affinity mask (in
+// util::threads::configureWorker) and memory follows the kernel's first-touch policy (a page lands on the node of the
+// thread that first writes it)
+//
+// work split in contiguous chunks (util::parallelChunks) maps chunk i of n to node i * nodes / n. the engine first
+// touches its image buffers with that split when it allocates them (MandelbrotSet::placeBuffers), so the whole image
+// passes, which use the same split, find their slice on their own node. everything is a no-op on single node machines
+//
+// disable with the MANDELBROT_NUMA=0 environment variable or util::numa::setEnabled() (see --no-numa in main.cpp)
+
+namespace util::numa
+{
+    struct Topology
+    {
+        std::vector<std::vector<int>> nodeCpus;    // cpus of every node the process may run on
+    };
+
+    // "0-3,8,10-11" -> { 0, 1, 2, 3, 8, 10, 11 }, the sysfs cpulist format (also taken by --cpus)
+    inline std::vector<int> parseCpuList(const std::string& list)
+    {
+        std::vector<int>  cpus;
+        std::stringstream ss{ list };
+        std::string       range;
+        while (std::getline(ss, range, ',')) {
+            if (range.empty())
+                continue;
+            const auto dash{ range.find('-') };
+            const int  first{ std::atoi(range.c_str()) };
+            const int  last{ dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1) };
+            for (int cpu{ first }; cpu <= last; ++cpu)
+                cpus.push_back(cpu);
+        }
+        return cpus;
+    }
+
+    // cpus the process may run on. sched_getaffinity() reads the mask of the calling thread, which is no longer the
+    // process' one once that thread is pinned (see util::threads::reservePresentationCpu), so it is read once, at the
+    // first call. call it before pinning any thread
+    inline const std::vector<int>& getProcessCpus()
+    {
+        static const std::vector<int> cpus{ [] {
+            std::vector<int> allowed;
+#ifdef __linux__
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            if (::sched_getaffinity(0, sizeof(set), &set) == 0) {
+                for (int cpu{ 0 }; cpu < CPU_SETSIZE; ++cpu) {
+                    if (CPU_ISSET(cpu, &set))
+                        allowed.push_back(cpu);
+                }
+            }
+#endif
+            return allowed;
+        }() };
+        return cpus;
+    }
+
+    namespace detail
+    {
+        inline Topology readTopology()
+        {
+            Topology topology;
+#ifdef __linux__
+            const auto& allowed{ getProcessCpus() };
+            if (allowed.empty())
+                return topology;
+
+            // node directories may be sparse (node0, node2, ...) and come in any order
+            std::vector<std::pair<int, std::vector<int>>> nodes;
+            std::error_code                               error;
+            for (const auto& entry : std::filesystem::directory_iterator{ "/sys/devices/system/node", error }) {
+                const auto name{ entry.path().filename().string() };
+                if (!name.starts_with("node") || name.size() == 4 || name.find_first_not_of("0123456789", 4) != std::string::npos)
+                    continue;
+
+                std::ifstream file{ entry.path() / "cpulist" };
+                std::string   list;
+                std::getline(file, list);
+
+                std::vector<int> cpus;
+                for (const int cpu : parseCpuList(list)) {
+                    if (std::find(allowed.begin(), allowed.end(), cpu) != allowed.end())
+                        cpus.push_back(cpu);
+                }
+                if (!cpus.empty())
+                    nodes.emplace_back(std::atoi(name.c_str() + 4), std::move(cpus));
+            }
+
+            std::sort(nodes.begin(), nodes.end());
+            for (auto& [number, cpus] : nodes)
+                topology.nodeCpus.push_back(std::move(cpus));
+#endif
+            return topology;
+        }
+
+        inline bool initialEnabled()
+        {
+            const char* env{ std::getenv("MANDELBROT_NUMA") };
+            return !env || std::string{ env } != "0";
+        }
+
+        inline bool g_enabled{ initialEnabled() };
+    }
+
+    inline const Topology& getTopology()
+    {
+        static const Topology topology{ detail::readTopology() };
+        return topology;
+    }
+
+    inline std::size_t getNodeCount()
+    {
+        const std::size_t count{ getTopology().nodeCpus.size() };
+        return count > 0 ? count : 1;
+    }
+
+    // placement only does anything with more than one node
+    inline bool isEnabled() { return detail::g_enabled && getNodeCount() > 1; }
+
+    inline void setEnabled(bool enable) { detail::g_enabled = enable; }
+
+    // node of chunk i when [0, length) is split in chunkNumber contiguous chunks
+    inline std::size_t getChunkNode(std::size_t chunk, std::size_t chunkNumber)
+    {
+        return chunkNumber > 0 ? chunk * getNodeCount() / chunkNumber : 0;
+    }
+}
+
+#endif /* ifndef NUMA_HPP */
@@ -0,0 +1,56 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <cstddef>
+#include <future>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "util/threads.hpp"
+
+namespace util
+{
+    // one chunk per worker, see util::threads::Config
+    inline std::size_t defaultChunkNumber()
+    {
+        return threads::getWorkerCount();
+    }
+
+    // split [0, length) into chunkNumber contiguous ranges and call func(chunkIndex, begin, end) on each of them
+    // concurrently. the split only depends on length and chunkNumber, so two calls with the same arguments produce the
+    // same ranges (multi-pass algorithms like prefix sums rely on this). every chunk runs with the configured worker
+    // affinity and niceness, on NUMA machines on the node of its range (see util/threads.hpp and util/numa.hpp)
+    template <typename Func>
+    void parallelChunks(std::size_t length, std::size_t chunkNumber, Func&& func)
+    {
+        if (chunkNumber == 0)
+            chunkNumber = 1;
+        const bool setup{ threads::needsWorkerSetup() };
+
+        std::vector<std::future<void>> futures;
+        for (std::size_t i{ 0 }; i < chunkNumber; i++) {
+            // proportional bounds spread the remainder, chunk sizes differ by one at most
+            auto startPos{ length * i / chunkNumber };
+            auto endPos{ length * (i + 1) / chunkNumber };
+
+            futures.emplace_back(std::async(std::launch::async, [&func, i, startPos, endPos, setup, chunkNumber] {
+                if (setup)
+                    threads::configureWorker(i, chunkNumber);
+                func(i, startPos, endPos);
+            }));
+        }
+
+        for (auto& future : futures) {
+            future.get();
+        }
+    }
+
+    template <typename Func>
+    void parallelChunks(std::size_t length, Func&& func)
+    {
+        parallelChunks(length, defaultChunkNumber(), std::forward<Func>(func));
+    }
+}
+
+#endif /* ifndef PARALLEL_HPP */
@@ -0,0 +1,23 @@
+#ifndef RECT_HPP
+#define RECT_HPP
+
+#include <cstddef>
+
+namespace util
+{
+    // axis aligned rectangle in pixels, x/y is the top-left corner (first row of the image data)
+    struct Rect
+    {
+        std::size_t x{};
+        std::size_t y{};
+        std::size_t width{};
+        std::size_t height{};
+
+        std::size_t getArea() const { return width * height; }
+        bool        isEmpty() const { return width == 0 || height == 0; }
+
+        bool operator==(const Rect&) const = default;
+    };
+}
+
+#endif /* ifndef RECT_HPP */
@@ -0,0 +1,136 @@
+#ifndef THREADS_HPP
+#define THREADS_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#    include <pthread.h>
+#    include <sched.h>
+#    include <sys/resource.h>
+#    include <unistd.h>
+#endif
+
+#include "util/numa.hpp"
+
+// how the render workers of util::parallelChunks run: how many there are, which cpus they may use, their niceness, and
+// one cpu kept for the presentation (GLFW) thread alone. set once at startup, before the first render (see --threads,
+// --cpus, --nice and --reserve-cpu in main.cpp)
+namespace util::threads
+{
+    struct Config
+    {
+        std::size_t        workerCount{ 0 };    // 0: one per usable cpu
+        std::vector<int>   cpus{};              // cpus the workers may run on, empty: all the process may use
+        int                nice{ 0 };           // added niceness of the workers, > 0 lets the UI thread go first
+        std::optional<int> reservedCpu{};       // taken out of the workers' cpus and given to reservePresentationCpu()
+    };
+
+    namespace detail
+    {
+        inline Config g_config{};
+
+#ifdef __linux__
+        // false without a single valid cpu, the mask is left alone then
+        inline bool setAffinity(const std::vector<int>& cpus)
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            bool any{ false };
+            for (const int cpu : cpus) {
+                if (cpu >= 0 && cpu < CPU_SETSIZE) {
+                    CPU_SET(cpu, &set);
+                    any = true;
+                }
+            }
+            return any && ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) == 0;
+        }
+#endif
+    }
+
+    inline const Config& getConfig() { return detail::g_config; }
+
+    // also reads the process' cpus and the NUMA topology while the calling thread still has the process' mask
+    inline void setConfig(const Config& config)
+    {
+        numa::getProcessCpus();
+        numa::getTopology();
+        detail::g_config = config;
+    }
+
+    // cpus the workers may run on: the configured ones (or the process' own) minus the reserved one
+    inline std::vector<int> getWorkerCpus()
+    {
+        const auto&      config{ detail::g_config };
+        std::vector<int> cpus;
+        for (const int cpu : config.cpus.empty() ? numa::getProcessCpus() : config.cpus) {
+            if (cpu != config.reservedCpu)
+                cpus.push_back(cpu);
+        }
+        return cpus;
+    }
+
+    inline std::size_t getWorkerCount()
+    {
+        if (detail::g_config.workerCount > 0)
+            return detail::g_config.workerCount;
+
+        std::size_t count{ getWorkerCpus().size() };
+        if (count == 0)
+            count = std::thread::hardware_concurrency();
+        return count > 0 ? count : 1;
+    }
+
+    // whether configureWorker has anything to do, skips the syscalls with the defaults on single node machines
+    inline bool needsWorkerSetup()
+    {
+        const auto& config{ detail::g_config };
+        return numa::isEnabled() || !config.cpus.empty() || config.nice != 0 || config.reservedCpu;
+    }
+
+    // called at the start of chunk i of n on its worker thread: cpus of the chunk's node within the worker cpus (all
+    // worker cpus when the two don't intersect) and the niceness. the workers are started by the presentation thread
+    // and inherit its mask, with a reserved cpu they must be given theirs. the threads are not reused, nothing leaks out
+    inline void configureWorker(std::size_t chunk, std::size_t chunkNumber)
+    {
+#ifdef __linux__
+        const auto&      config{ detail::g_config };
+        std::vector<int> cpus{ getWorkerCpus() };
+        if (numa::isEnabled()) {
+            std::vector<int> local;
+            for (const int cpu : numa::getTopology().nodeCpus[numa::getChunkNode(chunk, chunkNumber)]) {
+                if (std::find(cpus.begin(), cpus.end(), cpu) != cpus.end())
+                    local.push_back(cpu);
+            }
+            if (!local.empty())
+                cpus = std::move(local);
+        }
+        if (!config.cpus.empty() || config.reservedCpu || numa::isEnabled())
+            detail::setAffinity(cpus);
+
+        // on Linux the niceness is per thread
+        if (config.nice != 0)
+            ::setpriority(PRIO_PROCESS, static_cast<id_t>(::gettid()), ::getpriority(PRIO_PROCESS, 0) + config.nice);
+#else
+        (void)chunk;
+        (void)chunkNumber;
+#endif
+    }
+
+    // pin the calling thread to the reserved cpu, if any. call from the presentation thread, after setConfig()
+    inline bool reservePresentationCpu()
+    {
+#ifdef __linux__
+        numa::getProcessCpus();
+        numa::getTopology();
+        if (const auto cpu{ detail::g_config.reservedCpu })
+            return detail::setAffinity({ *cpu });
+#endif
+        return false;
+    }
+}
+
+#endif /* ifndef THREADS_HPP */
@@ -0,0 +1,100 @@
+#ifndef INPUT_RECORDING_H
+#define INPUT_RECORDING_H
+
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// recorded sessions for replaying the interactive path without a window (see --record and --replay in main.cpp). a
+// recording is a text file: a header line, then one line per change of the state the window callbacks drive (view,
+// window size and the render settings keys toggle), stamped with the seconds since the recording started. doubles are
+// written in their shortest round-trip form so the replayed views are bit identical
+struct InputState
+{
+    double time{};    // seconds since the start of the recording
+
+    double xCenter{};
+    double yCenter{};
+    double magnification{ 1.0 };
+    int    width{};
+    int    height{};
+
+    int    colorMode{};
+    int    exponent{ 2 };
+    bool   julia{};
+    double juliaReal{};
+    double juliaImag{};
+    bool   antiAliasing{};
+    bool   floatFastPath{ true };
+    bool   buddhabrot{};
+    int    iteration{ 5 };    // base iteration count, scaled with the zoom
+
+    // same state, whenever it happened
+    bool isSameState(const InputState& other) const
+    {
+        InputState copy{ other };
+        copy.time = time;
+        return copy == *this;
+    }
+
+    bool operator==(const InputState&) const = default;
+};
+
+namespace inputRecording
+{
+    inline constexpr const char* s_header{ "mandelbrot-set input 2" };
+
+    inline void write(std::ostream& out, const InputState& state)
+    {
+        out << std::format(
+            "{} {} {} {} {} {} {} {} {} {} {} {} {} {} {}\n",
+            state.time,
+            state.xCenter,
+            state.yCenter,
+            state.magnification,
+            state.width,
+            state.height,
+            state.colorMode,
+            state.exponent,
+            static_cast<int>(state.julia),
+            state.juliaReal,
+            state.juliaImag,
+            static_cast<int>(state.antiAliasing),
+            static_cast<int>(state.floatFastPath),
+            static_cast<int>(state.buddhabrot),
+            state.iteration
+        );
+    }
+
+    inline std::optional<InputState> read(std::istream& in)
+    {
+        InputState state;
+        in >> state.time >> state.xCenter >> state.yCenter >> state.magnification >> state.width >> state.height
+            >> state.colorMode >> state.exponent >> state.julia >> state.juliaReal >> state.juliaImag >> state.antiAliasing
+            >> state.floatFastPath >> state.buddhabrot >> state.iteration;
+        if (!in)
+            return std::nullopt;
+        return state;
+    }
+
+    // nothing when the file can't be read or isn't a recording
+    inline std::optional<std::vector<InputState>> load(const std::filesystem::path& path)
+    {
+        std::ifstream file{ path };
+        std::string   header;
+        if (!std::getline(file, header) || header != s_header)
+            return std::nullopt;
+
+        std::vector<InputState> states;
+        while (auto state{ read(file) })
+            states.push_back(*state);
+        return states;
+    }
+}
+
+#endif /* ifndef INPUT_RECORDING_H */
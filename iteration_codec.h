@@ -0,0 +1,184 @@
+#ifndef ITERATION_CODEC_H
+#define ITERATION_CODEC_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+#include "util/parallel.hpp"
+
+// compact form of iteration counts, used by the tile cache. neighbouring pixels mostly differ by a few iterations and
+// the interior and the far exterior are long runs of a single count, so every run of equal values is stored as the
+// varint of its zigzagged difference to the previous value, with the low bit telling whether a varint repeat count
+// follows. a 4 byte count usually takes a single byte, a run a few bytes whatever its length
+//
+// the values are split in blocks of s_blockValues that start over from 0, encoded and decoded in parallel. layout:
+// value count (u64), block count (u32), end offset of every block in the block data (u32 each), block data
+namespace iterationCodec
+{
+    inline constexpr std::size_t s_blockValues{ 1 << 14 };
+
+    namespace detail
+    {
+        struct Header
+        {
+            std::uint64_t count;
+            std::uint32_t blockCount;
+        };
+
+        inline constexpr std::size_t s_headerSize{ sizeof(std::uint64_t) + sizeof(std::uint32_t) };
+
+        inline void putVarint(std::vector<std::uint8_t>& out, std::uint64_t value)
+        {
+            while (value >= 0x80) {
+                out.push_back(static_cast<std::uint8_t>(value | 0x80));
+                value >>= 7;
+            }
+            out.push_back(static_cast<std::uint8_t>(value));
+        }
+
+        // false when the data ends before the varint does
+        inline bool getVarint(const std::uint8_t*& data, const std::uint8_t* end, std::uint64_t& value)
+        {
+            value = 0;
+            for (int shift{ 0 }; shift < 64 && data < end; shift += 7) {
+                const std::uint8_t byte{ *data++ };
+                value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+                if (!(byte & 0x80))
+                    return true;
+            }
+            return false;
+        }
+
+        inline void encodeBlock(std::span<const std::int32_t> values, std::vector<std::uint8_t>& out)
+        {
+            std::uint32_t previous{ 0 };
+            for (std::size_t i{ 0 }; i < values.size();) {
+                std::size_t run{ 1 };
+                while (i + run < values.size() && values[i + run] == values[i])
+                    ++run;
+
+                // wrapping difference, zigzagged so that small negative ones stay small too
+                const auto value{ static_cast<std::uint32_t>(values[i]) };
+                const auto delta{ static_cast<std::int32_t>(value - previous) };
+                const auto zigzag{ (static_cast<std::uint32_t>(delta) << 1) ^ static_cast<std::uint32_t>(delta >> 31) };
+                putVarint(out, (static_cast<std::uint64_t>(zigzag) << 1) | (run > 1 ? 1 : 0));
+                if (run > 1)
+                    putVarint(out, run - 2);
+
+                previous  = value;
+                i        += run;
+            }
+        }
+
+        // false on data that doesn't decode to exactly values.size() values
+        inline bool decodeBlock(std::span<const std::uint8_t> data, std::span<std::int32_t> values)
+        {
+            const std::uint8_t* in{ data.data() };
+            const std::uint8_t* end{ in + data.size() };
+            std::uint32_t       previous{ 0 };
+            for (std::size_t i{ 0 }; i < values.size();) {
+                std::uint64_t token;
+                if (!getVarint(in, end, token))
+                    return false;
+                const auto zigzag{ static_cast<std::uint32_t>(token >> 1) };
+                previous += (zigzag >> 1) ^ (0u - (zigzag & 1));
+
+                if (!(token & 1)) {
+                    values[i++] = static_cast<std::int32_t>(previous);
+                    continue;
+                }
+                std::uint64_t run;
+                if (!getVarint(in, end, run) || values.size() - i < 2 || run > values.size() - i - 2)
+                    return false;
+                run += 2;
+                std::fill_n(values.begin() + static_cast<std::ptrdiff_t>(i), run, static_cast<std::int32_t>(previous));
+                i += run;
+            }
+            return in == end;
+        }
+
+        inline bool readHeader(std::span<const std::uint8_t> data, Header& header)
+        {
+            if (data.size() < s_headerSize)
+                return false;
+            std::memcpy(&header.count, data.data(), sizeof(header.count));
+            std::memcpy(&header.blockCount, data.data() + sizeof(header.count), sizeof(header.blockCount));
+            return header.blockCount == (header.count + s_blockValues - 1) / s_blockValues
+                && data.size() >= s_headerSize + header.blockCount * sizeof(std::uint32_t);
+        }
+    }
+
+    inline std::vector<std::uint8_t> encode(std::span<const std::int32_t> values)
+    {
+        const std::size_t                      blockCount{ (values.size() + s_blockValues - 1) / s_blockValues };
+        std::vector<std::vector<std::uint8_t>> blocks(blockCount);
+        util::parallelChunks(blockCount, [&](std::size_t, std::size_t first, std::size_t last) {
+            for (std::size_t b{ first }; b < last; ++b) {
+                const std::size_t begin{ b * s_blockValues };
+                detail::encodeBlock(values.subspan(begin, std::min(s_blockValues, values.size() - begin)), blocks[b]);
+            }
+        });
+
+        const std::uint64_t       count{ values.size() };
+        const auto                blockNumber{ static_cast<std::uint32_t>(blockCount) };
+        std::vector<std::uint8_t> out(detail::s_headerSize + blockCount * sizeof(std::uint32_t));
+        std::memcpy(out.data(), &count, sizeof(count));
+        std::memcpy(out.data() + sizeof(count), &blockNumber, sizeof(blockNumber));
+
+        std::uint32_t blockEnd{ 0 };
+        for (std::size_t b{ 0 }; b < blockCount; ++b) {
+            blockEnd += static_cast<std::uint32_t>(blocks[b].size());
+            std::memcpy(out.data() + detail::s_headerSize + b * sizeof(blockEnd), &blockEnd, sizeof(blockEnd));
+        }
+        out.reserve(out.size() + blockEnd);
+        for (const auto& block : blocks)
+            out.insert(out.end(), block.begin(), block.end());
+        return out;
+    }
+
+    // number of values data decodes to, 0 when it isn't encoded data
+    inline std::size_t getCount(std::span<const std::uint8_t> data)
+    {
+        detail::Header header;
+        return detail::readHeader(data, header) ? static_cast<std::size_t>(header.count) : 0;
+    }
+
+    // false when data doesn't hold exactly values.size() values, values is left partly written then
+    inline bool decode(std::span<const std::uint8_t> data, std::span<std::int32_t> values)
+    {
+        detail::Header header;
+        if (!detail::readHeader(data, header) || header.count != values.size())
+            return false;
+
+        const std::size_t tableEnd{ detail::s_headerSize + header.blockCount * sizeof(std::uint32_t) };
+        const auto        blocks{ data.subspan(tableEnd) };
+        const auto        getBlockEnd{ [&data](std::size_t b) {
+            std::uint32_t end;
+            std::memcpy(&end, data.data() + detail::s_headerSize + b * sizeof(end), sizeof(end));
+            return static_cast<std::size_t>(end);
+        } };
+        if (header.blockCount > 0 && getBlockEnd(header.blockCount - 1) != blocks.size())
+            return false;
+
+        std::atomic<bool> valid{ true };
+        util::parallelChunks(header.blockCount, [&](std::size_t, std::size_t first, std::size_t last) {
+            for (std::size_t b{ first }; b < last && valid; ++b) {
+                const std::size_t dataBegin{ b > 0 ? getBlockEnd(b - 1) : 0 };
+                const std::size_t dataEnd{ getBlockEnd(b) };
+                const std::size_t begin{ b * s_blockValues };
+                if (dataBegin > dataEnd || dataEnd > blocks.size()
+                    || !detail::decodeBlock(blocks.subspan(dataBegin, dataEnd - dataBegin), values.subspan(begin, std::min(s_blockValues, values.size() - begin)))) {
+                    valid = false;
+                }
+            }
+        });
+        return valid;
+    }
+}
+
+#endif /* ifndef ITERATION_CODEC_H */
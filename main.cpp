@@ -1,11 +1,20 @@
 #include <iostream>
+#include <memory>
+#include <optional>
 #include <random>
 #include <ctime>
 #include <sstream>
+#include <string>
+#include <vector>
 
 #include "mandelbrot_set.h"
+#include "input_recording.h"
 #include "render.h"
+#include "tile_cache.h"
 
+#include "util/cpu_features.hpp"
+#include "util/numa.hpp"
+#include "util/threads.hpp"
 #include "util/timer.hpp"
 
 int getRandomNumber(int min, int max)
@@ -23,43 +32,137 @@ double getRandomNormal()
 
 int main(int argc, char** argv)
 {
+    // options start with "--", everything else is positional
+    std::vector<std::string> args;
+    auto                     cacheDirectory{ TileCache::getDefaultDirectory() };
+    util::threads::Config    threads;
+    bool                     cacheChosen{ false };
+    std::string              recordPath;
+    std::string              replayPath;
+    for (int i{ 1 }; i < argc; ++i) {
+        std::string arg{ argv[i] };
+        if (arg.starts_with("--isa=")) {
+            auto name{ arg.substr(std::size("--isa=") - 1) };
+            auto isa{ util::cpu::parseIsa(name) };
+            if (!isa || !util::cpu::setIsa(*isa)) {
+                std::cerr << "Instruction set '" << name << "' is unknown or not supported by this CPU\n";
+                return 1;
+            }
+        } else if (arg.starts_with("--frame-target=")) {
+            std::stringstream ss{ arg.substr(std::size("--frame-target=") - 1) };
+            ss >> RenderEngine::resolution::targetFrameTime;
+        } else if (arg.starts_with("--budget=")) {
+            std::stringstream ss{ arg.substr(std::size("--budget=") - 1) };
+            ss >> RenderEngine::configuration::renderBudget;
+        } else if (arg.starts_with("--cache=")) {
+            cacheDirectory = arg.substr(std::size("--cache=") - 1);
+            cacheChosen    = true;
+        } else if (arg == "--no-cache") {
+            cacheDirectory = std::nullopt;
+            cacheChosen    = true;
+        } else if (arg.starts_with("--record=")) {
+            recordPath = arg.substr(std::size("--record=") - 1);
+        } else if (arg.starts_with("--replay=")) {
+            replayPath = arg.substr(std::size("--replay=") - 1);
+        } else if (arg.starts_with("--threads=")) {
+            std::stringstream ss{ arg.substr(std::size("--threads=") - 1) };
+            ss >> threads.workerCount;
+        } else if (arg.starts_with("--cpus=")) {
+            threads.cpus = util::numa::parseCpuList(arg.substr(std::size("--cpus=") - 1));
+        } else if (arg.starts_with("--nice=")) {
+            std::stringstream ss{ arg.substr(std::size("--nice=") - 1) };
+            ss >> threads.nice;
+        } else if (arg.starts_with("--reserve-cpu=")) {
+            std::stringstream ss{ arg.substr(std::size("--reserve-cpu=") - 1) };
+            int               cpu{};
+            if (ss >> cpu)
+                threads.reservedCpu = cpu;
+        } else if (arg == "--no-numa") {
+            util::numa::setEnabled(false);
+        } else if (arg == "--no-preview") {
+            RenderEngine::preview::enabled = false;
+        } else if (arg == "--no-pbo") {
+            RenderEngine::configuration::streamTexture = false;
+        } else {
+            args.push_back(std::move(arg));
+        }
+    }
+
     std::size_t width{ 400 };
     std::size_t height{ 400 };
-    if (argc > 1) {
-        if (std::string{ argv[1] } == "-h") {
-            std::cout << "Usage: " << argv[0] << " <width, height> <iteration> <radius>\n";
+    if (args.size() > 0) {
+        if (args[0] == "-h") {
+            std::cout << "Usage: " << argv[0] << " [--isa=generic|avx2|avx512] [--no-pbo] [--frame-target=<ms>] [--budget=<ms>] [--cache=<dir>|--no-cache] [--no-numa] [--no-preview] [--threads=<n>] [--cpus=<list>] [--nice=<n>] [--reserve-cpu=<cpu>] [--record=<file>|--replay=<file>] <width, height> <iteration> <radius>\n";
             return 0;
         }
 
         char              tmp{};
-        std::stringstream ss{ argv[1] };
+        std::stringstream ss{ args[0] };
         ss >> width;
         ss >> tmp;
         ss >> height;
     }
 
     int iteration{ 20 };
-    if (argc > 2) {
-        std::stringstream ss{ argv[2] };
+    if (args.size() > 1) {
+        std::stringstream ss{ args[1] };
         ss >> iteration;
     }
 
     double radius{ 100.0 };
-    if (argc > 3) {
-        std::stringstream ss{ argv[3] };
+    if (args.size() > 2) {
+        std::stringstream ss{ args[2] };
         ss >> radius;
     }
 
+    util::threads::setConfig(threads);
+    util::threads::reservePresentationCpu();
+
+    std::cout << "Kernel instruction set: " << util::cpu::getName(util::cpu::getIsa()) << '\n';
+    std::cout << "Render workers: " << util::threads::getWorkerCount() << '\n';
+    if (util::numa::isEnabled())
+        std::cout << "NUMA nodes: " << util::numa::getNodeCount() << '\n';
+
 #ifdef NDEBUG
     util::Timer::s_doPrint = false;
 #else
     util::Timer::s_doPrint = true;
 #endif
 
+    // a replay starts from the recorded window size, and a warm cache would skew the timings unless asked for
+    std::vector<InputState> inputs;
+    if (!replayPath.empty()) {
+        auto loaded{ inputRecording::load(replayPath) };
+        if (!loaded || loaded->empty()) {
+            std::cerr << "'" << replayPath << "' is not a recording\n";
+            return 1;
+        }
+        inputs                 = std::move(*loaded);
+        width                  = static_cast<std::size_t>(inputs.front().width);
+        height                 = static_cast<std::size_t>(inputs.front().height);
+        util::Timer::s_doPrint = false;
+        if (!cacheChosen)
+            cacheDirectory = std::nullopt;
+    }
+
     MandelbrotSet<RenderEngine::Value_type> set{ width, height };
     set.modifyCenter(-0.75, 0);
 
+    std::unique_ptr<TileCache> cache;
+    if (cacheDirectory) {
+        cache = std::make_unique<TileCache>(*cacheDirectory);
+        set.setTileCache(cache.get());
+        std::cout << "Tile cache: " << cache->getDirectory().string() << '\n';
+    }
+
+    if (!inputs.empty())
+        return RenderEngine::replay(set, inputs, iteration, radius);
+
     RenderEngine::initialize(set, width, height, iteration, radius);
+    if (!recordPath.empty() && !RenderEngine::startRecording(recordPath)) {
+        std::cerr << "Can't write the recording to '" << recordPath << "'\n";
+        return 1;
+    }
     while (!RenderEngine::shouldClose()) {
         RenderEngine::render();
     }
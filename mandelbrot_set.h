@@ -1,13 +1,30 @@
 #ifndef MANDELBROT_SET_H
 #define MANDELBROT_SET_H
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <complex>
+#include <cstdint>
 #include <cmath>
 #include <format>
 #include <future>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <type_traits>
 #include <utility>    // std::pair
+#include <vector>
 
+#include "./tile_cache.h"
 #include "./unrolled_matrix.h"
+#include "util/channel.hpp"
+#include "util/cpu_features.hpp"
+#include "util/numa.hpp"
+#include "util/parallel.hpp"
+#include "util/rect.hpp"
 #include "util/timer.hpp"
 
 // any T that can apply to std::complex<T>
@@ -15,14 +32,240 @@ template <typename T = double>
 class MandelbrotSet
 {
 public:
-    using Value_type       = T;
-    using Cell_type        = std::complex<Value_type>;
-    using Grid_type        = UnrolledMatrix<Cell_type>;
-    using Pixel_type       = std::array<unsigned char, 4>;
-    using TextureData_type = UnrolledMatrix<Pixel_type>;
+    using Value_type         = T;
+    using Cell_type          = std::complex<Value_type>;
+    using Grid_type          = UnrolledMatrix<Cell_type>;
+    using Pixel_type         = std::array<unsigned char, 4>;
+    using TextureData_type   = UnrolledMatrix<Pixel_type>;
+    using Iteration_type     = int;
+    using IterationData_type = UnrolledMatrix<Iteration_type>;
+    using Count_type         = std::uint16_t;    // iteration count as uploaded for ColorMode::shader (GL_R16)
+    using CountData_type     = UnrolledMatrix<Count_type>;
+    using ContrastData_type  = UnrolledMatrix<Iteration_type, layout::Tiled<>>;    // anti-aliasing edge detection
+
+    enum class ColorMode
+    {
+        cosine,       // palette indexed directly by the iteration count
+        histogram,    // palette indexed by the cumulative iteration histogram (no banding at deep zoom)
+        distance,     // grayscale by exterior distance estimate, dark boundary on white
+        shader,       // iteration counts only, the palette is evaluated in the fragment shader (see generateCounts)
+    };
+
+    struct Escape
+    {
+        Value_type     squareModulus{};
+        Iteration_type iteration{};
+        Value_type     distance{};    // exterior distance estimate, only computed by iterate<true>
+    };
+
+    // the iterated map z^exponent + c, over the parameter plane with z starting at 0 (Mandelbrot, Multibrot for higher
+    // exponents) or over the starting point with a fixed c (Julia). every combination is its own kernel instantiation
+    struct Formula
+    {
+        int       exponent{ 2 };    // from 2 to s_maxExponent
+        bool      julia{ false };
+        Cell_type juliaC{ -0.8, 0.156 };
+
+        bool operator==(const Formula&) const = default;
+    };
+
+    static constexpr int s_maxExponent{ 6 };
+
+    // immutable snapshot of everything that defines one rendered image
+    struct ViewParams
+    {
+        Value_type  xCenter{ 0.0 };
+        Value_type  yCenter{ 0.0 };
+        Value_type  magnification{ 1.0 };
+        std::size_t width{};
+        std::size_t height{};
+        std::size_t iteration{};
+        Value_type  radius{ 1000.0 };
+
+        // from -2 to 2 (of y component), the same spacing on x to preserve 1:1 ratio on the graph
+        Value_type  getDelta() const { return (4 / static_cast<Value_type>(height)) / magnification; }
+        Value_type  getAspectRatio() const { return static_cast<Value_type>(width) / height; }
+        std::size_t getLength() const { return width * height; }
+
+        // complex value at the corner of the first pixel (its centre is half a delta further)
+        Cell_type getOrigin() const
+        {
+            return { xCenter - (2.0 * getAspectRatio()) / magnification, yCenter - 2.0 / magnification };
+        }
+
+        bool operator==(const ViewParams&) const = default;
+    };
+
+    // sub-pixel sample positions used when a pixel is supersampled
+    enum class SamplePattern
+    {
+        grid2x2,
+        rotatedGrid4,    // 4 samples, rotated grid: better edge coverage than grid2x2 for the same cost
+        grid4x4,
+    };
+
+    struct AntiAliasing
+    {
+        bool           enabled{ false };
+        SamplePattern  pattern{ SamplePattern::rotatedGrid4 };
+        Iteration_type threshold{ 2 };                // resample a pixel when a neighbour differs by more than this
+        double         maxPixelFraction{ 0.25 };      // cap on resampled pixels, the highest contrast ones are kept
+    };
+
+    // a pixel still iterating when the limit of its view was reached, with the kernel state it stopped in
+    struct ResumePoint
+    {
+        std::uint32_t pos;
+        bool          finished;    // escaped or caught since, dropped once the view is complete
+        Value_type    zReal;
+        Value_type    zImag;
+        Value_type    derReal;
+        Value_type    derImag;
+    };
+
+    // what a render needs to raise the iteration limit of a view without starting over: the pixels that were still
+    // running at the old limit. escaped pixels keep their count and pixels caught by the derivative test stay interior,
+    // only the running ones are iterated further. goes together with the iteration counts it was rendered with
+    struct ResumeState
+    {
+        std::optional<ViewParams>                        view{};        // view the points belong to, nothing while they are incomplete
+        Formula                                          formula{};
+        bool                                             useFloat{};
+        std::vector<ResumePoint>                         points{};      // by position
+        std::vector<std::pair<std::size_t, std::size_t>> mirrored{};    // (row, source row) of rows copied from their mirror
+    };
+
+    static constexpr Pixel_type s_interiorColor{ 0x00, 0x00, 0x00, 0xff };
+
+    // cosine palette parameters, shared with the fragment shader for ColorMode::shader
+    static constexpr double                   s_paletteOffset{ 0.2 };
+    static inline const std::array<double, 3> s_paletteFrequency{
+        1 / (7.0 * std::pow(3.0, 0.25)),
+        1 / (3.0 * std::sqrt(2.0)),
+        1 / (2.0 * std::log(5.0)),
+    };
+
+    // number of palette periods the equalized [0, 1] range is spread over
+    static constexpr double s_histogramPaletteSpan{ 32.0 };
+
+    // distance (in pixels) from the boundary at which the distance shading reaches full white
+    static constexpr double s_distanceShadingWidth{ 4.0 };
+
+    // rows of the first band of an incremental render, later bands are sized from the measured time per row
+    static constexpr std::size_t s_initialBandRows{ 8 };
+
+    // tile cache key precision (see getCacheKey): bits of magnification mantissa, centre steps per pixel
+    static constexpr int    s_cacheKeyBits{ 24 };
+    static constexpr double s_cachePositionSteps{ 16.0 };
+
+    // no row has the conjugate imaginary part of this one (see Frame::mirrors)
+    static constexpr std::size_t s_noRow{ std::numeric_limits<std::size_t>::max() };
+
+    // the float kernel is used while the pixel spacing is at least this many float epsilons of the coordinates
+    static constexpr double s_floatPrecisionMargin{ 1024.0 };
+
+    // points iterated together by the batched kernel, one 512-bit register worth of U (the compiler splits it on
+    // narrower ISAs). float batches are twice as wide as double ones
+    template <typename U>
+    static constexpr std::size_t s_batchLanes{ 64 / sizeof(U) };
+
+    // finished bands of a view rendered in the background by streamTiles(). next() blocks until the next band is done
+    // and returns nothing once the view is complete (rethrowing what the render threw, if anything). destroying the
+    // stream early stops the render after the band in progress
+    class TileStream
+    {
+    public:
+        struct Tile
+        {
+            util::Rect                      region;        // full rows, so the spans below are contiguous
+            std::span<const Pixel_type>     pixels;        // empty in ColorMode::shader
+            std::span<const Iteration_type> iterations;
+        };
+
+        TileStream(
+            const ViewParams&                          view,
+            std::span<const Pixel_type>                pixels,
+            std::span<const Iteration_type>            iterations,
+            std::unique_ptr<util::Channel<util::Rect>> finished,
+            std::future<void>                          producer
+        )
+            : m_view{ view }
+            , m_pixels{ pixels }
+            , m_iterations{ iterations }
+            , m_finished{ std::move(finished) }
+            , m_producer{ std::move(producer) }
+        {
+        }
+
+        TileStream(TileStream&&)            = default;
+        TileStream& operator=(TileStream&&) = delete;
+
+        ~TileStream()
+        {
+            if (m_finished)
+                m_finished->close();
+            if (m_producer.valid())
+                m_producer.wait();
+        }
+
+        std::optional<Tile> next()
+        {
+            if (const auto region{ m_finished->pop() }) {
+                const std::size_t offset{ region->y * m_view.width };
+                const std::size_t length{ region->getArea() };
+                return Tile{
+                    .region     = *region,
+                    .pixels     = m_pixels.empty() ? m_pixels : m_pixels.subspan(offset, length),
+                    .iterations = m_iterations.subspan(offset, length),
+                };
+            }
+            if (m_producer.valid())
+                m_producer.get();
+            return std::nullopt;
+        }
+
+    private:
+        ViewParams                                 m_view;
+        std::span<const Pixel_type>                m_pixels;
+        std::span<const Iteration_type>            m_iterations;
+        std::unique_ptr<util::Channel<util::Rect>> m_finished;
+        std::future<void>                          m_producer;
+    };
 
 private:
-    TextureData_type m_texture{};
+    TextureData_type   m_texture{};
+    IterationData_type m_iterations{};
+    CountData_type     m_counts{};
+    ColorMode          m_colorMode{ ColorMode::cosine };
+    Formula            m_formula{};
+    TileCache*         m_tileCache{};    // not owned, iteration counts of finished views are reused through it
+    bool               m_cacheStores{ true };
+    AntiAliasing       m_antiAliasing{};
+    bool               m_floatFastPath{ true };
+    bool               m_usingFloat{ false };    // precision picked by the last generateTexture call
+    ResumeState        m_resume{};               // of m_iterations, raising the limit of its view continues from here
+
+    // key of m_iterations when its view was finished while cache stores were off, stored once they are back on
+    std::optional<TileCache::Key> m_pendingStore{};
+
+    // what the engine's texture data currently shows, and the parts of it changed since the last takeDirtyRegions()
+    std::optional<ViewParams> m_lastView{};
+    bool                      m_settingsChanged{ true };
+    std::vector<util::Rect>   m_dirtyRegions{};
+
+    // state of the incremental render (see generateStep) carried over between calls
+    struct Progress
+    {
+        ViewParams                 view;
+        std::size_t                startRow{};      // bands are rendered from here, wrapping around at the bottom
+        std::size_t                rowsDone{};
+        std::vector<Pixel_type>    palette{};       // cosine palette of the view, built once
+        bool                       cached{};        // loaded from the tile cache, nothing to store
+        std::optional<std::size_t> resumeFrom{};    // limit of m_resume the bands continue from, if any
+        double                     rowTime{};       // in ms, measured on the last band
+        double                     elapsed{};       // in ms, spent on this view so far
+    };
+    std::optional<Progress> m_progress{};
 
     std::size_t m_width{};
     std::size_t m_height{};
@@ -30,8 +273,44 @@ private:
     Value_type m_xCenter{ 0.0 };
     Value_type m_yCenter{ 0.0 };
     Value_type m_magnification{ 1.0 };
-    Value_type m_xDelta{};
-    Value_type m_yDelta{};
+
+    // everything one render call works on. concurrent renders each have their own and share nothing but the (read
+    // only) settings of the engine
+    struct Frame
+    {
+        const ViewParams&         view;
+        std::span<Pixel_type>     pixels;
+        std::span<Iteration_type> iterations;
+        Value_type                delta;
+        std::vector<Value_type>   xs;           // real part of each column
+        std::vector<Value_type>   ys;           // imaginary part of each row
+        std::vector<Pixel_type>   palette;      // colour of each iteration count, palette[iteration] is the interior
+        std::vector<std::size_t>  mirrors;      // row of the opposite imaginary part of each row, empty: none at all
+        ResumeState*              resume{};     // when set, collects the pixels still running at the limit
+
+        Frame(const ViewParams& view, std::span<Pixel_type> pixels, std::span<Iteration_type> iterations)
+            : view{ view }
+            , pixels{ pixels }
+            , iterations{ iterations }
+            , delta{ view.getDelta() }
+            , xs(view.width)
+            , ys(view.height)
+        {
+            const Cell_type origin{ view.getOrigin() };
+            for (std::size_t x{ 0 }; x < view.width; ++x)
+                xs[x] = static_cast<Value_type>(x) * delta + delta / 2.0 + origin.real();
+            // rows are placed symmetrically about the centre, so that views centred on the real axis mirror bit for bit
+            for (std::size_t y{ 0 }; y < view.height; ++y)
+                ys[y] = view.yCenter + (static_cast<Value_type>(y) - static_cast<Value_type>(view.height - 1) / 2) * delta;
+        }
+
+        Cell_type at(std::size_t xPos, std::size_t yPos) const { return { xs[xPos], ys[yPos] }; }
+        Cell_type at(std::size_t pos) const { return at(pos % view.width, pos / view.width); }
+
+        // rows [row, row + rows) of the buffers, for the MatrixView passes
+        MatrixView<Pixel_type>     getPixelRows(std::size_t row, std::size_t rows) const { return { pixels.subspan(row * view.width, rows * view.width), view.width, rows }; }
+        MatrixView<Iteration_type> getIterationRows(std::size_t row, std::size_t rows) const { return { iterations.subspan(row * view.width, rows * view.width), view.width, rows }; }
+    };
 
 public:
     MandelbrotSet(
@@ -41,111 +320,600 @@ public:
         : m_width{ width }
         , m_height{ height }
         , m_texture{ width, height }
+        , m_iterations{ width, height }
+        , m_counts{ width, height }
     {
+        placeBuffers();
     }
 
-    Cell_type getGridValue(std::size_t xPos, std::size_t yPos)
+    // snapshot of the current view, to be rendered with render()
+    ViewParams getViewParams(std::size_t iteration, Value_type radius = 1000.0) const
     {
-        // from -2 to 2 (of y component)
-        m_yDelta = (4 / static_cast<Value_type>(m_height)) / m_magnification;
-
-        // preserve 1:1 ratio on the graph
-        const Value_type aspectRatio{ static_cast<Value_type>(m_width) / m_height };
-        m_xDelta = (4 / static_cast<Value_type>(m_width) * aspectRatio) / m_magnification;
+        return { m_xCenter, m_yCenter, m_magnification, m_width, m_height, iteration, radius };
+    }
 
-        const Cell_type offset{
-            m_xCenter - (2.0 * aspectRatio) / m_magnification,
-            m_yCenter - 2.0 / m_magnification
+    // the same values as the rendered pixels (see Frame)
+    Cell_type getGridValue(std::size_t xPos, std::size_t yPos) const
+    {
+        const ViewParams view{ getViewParams(0) };
+        const Value_type delta{ view.getDelta() };
+        const Cell_type  offset{ view.getOrigin() };
+        return {
+            static_cast<Value_type>(xPos) * delta + delta / 2.0 + offset.real(),
+            view.yCenter + (static_cast<Value_type>(yPos) - static_cast<Value_type>(view.height - 1) / 2) * delta,
         };
-        Cell_type value{ static_cast<Value_type>(xPos) * m_xDelta + m_xDelta / 2.0, static_cast<Value_type>(yPos) * m_yDelta + m_yDelta / 2.0 };
-        return value + offset;
     }
 
-    TextureData_type& generateTexture(std::size_t iteration, Value_type radius = 1000.0)
+    // z^Exponent with the power unrolled at compile time (square and multiply), as separate real and imaginary parts
+    template <int Exponent, typename U>
+    [[gnu::always_inline]] static inline void power(U real, U imag, U& outReal, U& outImag)
     {
-        util::Timer timer{ "generateMandelbrotSet" };
+        static_assert(Exponent >= 1);
+        if constexpr (Exponent == 1) {
+            outReal = real;
+            outImag = imag;
+        } else if constexpr (Exponent % 2 == 0) {
+            U halfReal, halfImag;
+            power<Exponent / 2>(real, imag, halfReal, halfImag);
+            outReal = halfReal * halfReal - halfImag * halfImag;
+            outImag = 2 * halfReal * halfImag;
+        } else {
+            U lowerReal, lowerImag;
+            power<Exponent - 1>(real, imag, lowerReal, lowerImag);
+            outReal = lowerReal * real - lowerImag * imag;
+            outImag = lowerReal * imag + lowerImag * real;
+        }
+    }
 
-        // chunking
-        std::size_t length{ m_width * m_height };
-        std::size_t chunkNumber{ std::thread::hardware_concurrency() };
-        std::size_t chunkSize{ length / chunkNumber };
+    // escape time of a single point. points that never escape (or are caught by the derivative test) get the full
+    // iteration count. the derivative test multiplies by the map's derivative Exponent * Z^(Exponent - 1); the original
+    // kernel used (2 + 2i) * Z, sqrt(2) larger and rotated, so points are caught at other iterations than there. the
+    // exact factor keeps the test symmetric about the real axis (see findMirrors). the exterior distance estimate needs
+    // the derivative by the plane's variable (dZ/dc, or dZ/dZ0 for Julia sets, which is the one the interior test uses
+    // anyway), so it is only tracked when asked for
+    template <bool withDistance = false, int Exponent = 2, bool Julia = false>
+    Escape iterate(const Cell_type& point, std::size_t iteration, Value_type radius) const
+    {
+        const Cell_type c{ Julia ? m_formula.juliaC : point };
 
-        std::vector<std::future<void>> futures;
-        for (std::size_t i{ 0 }; i < chunkNumber; i++) {
-            auto startPos{ chunkSize * i };
-            auto endPos{ startPos + chunkSize };
-            if (endPos >= length) endPos = length;
+        Cell_type Z{ point };
+        Cell_type der{ 1 };
+        Cell_type derC{ 1 };
 
-            futures.emplace_back(std::async(std::launch::async, [this, &iteration, &radius, i, startPos, endPos] {
-                util::Timer timer{ std::format("chunk {}", i) };
-                for (std::size_t start{ startPos }; start < endPos; start++) {
-                    std::size_t xPos{ start % m_width };
-                    std::size_t yPos{ start / m_width };
-                    Cell_type   c{ getGridValue(xPos, yPos) };
-                    Cell_type   Z{ c };
-                    Cell_type   der{ 1 };
-
-                    std::size_t                               i{ 0 };
-                    std::optional<std::pair<Value_type, int>> iterationData;
-                    Value_type                                squareModulus{};
-                    for (; i < iteration; ++i) {
-                        if ((squareModulus = std::norm(Z)) > radius * radius) {
-                            iterationData = { squareModulus, i };
-                            break;
-                        }
+        std::size_t i{ 0 };
+        Value_type  squareModulus{};
+        for (; i < iteration; ++i) {
+            if ((squareModulus = std::norm(Z)) > radius * radius) {
+                Escape escape{ squareModulus, static_cast<Iteration_type>(i) };
+                if constexpr (withDistance) {
+                    // 2|Z|ln|Z| / |dZ|, with ln|Z| = ln(|Z|^2) / 2
+                    escape.distance = std::sqrt(squareModulus) * std::log(squareModulus) / std::abs(Julia ? der : derC);
+                }
+                return escape;
+            }
 
-                        constexpr Cell_type  mul{ 2.0, 2.0 };
-                        constexpr Value_type eps{ 0.1 };
-                        if ((std::norm(der = der * mul * Z)) < eps * eps) {
-                            iterationData = { 0.0, iteration };
-                            break;
-                        }
+            // Exponent * Z^(Exponent - 1), the derivative of the map
+            Value_type lowerReal, lowerImag;
+            power<Exponent - 1>(Z.real(), Z.imag(), lowerReal, lowerImag);
+            const Cell_type slope{ Value_type{ Exponent } * Cell_type{ lowerReal, lowerImag } };
 
-                        Z = Z * Z + c;
-                    }
+            constexpr Value_type eps{ 0.1 };
+            if ((std::norm(der = der * slope)) < eps * eps)
+                return { 0.0, static_cast<Iteration_type>(iteration) };
 
-                    const auto& [value, iter]{ iterationData.has_value() ? iterationData.value() : std::pair{ squareModulus, (int)i } };
+            if constexpr (withDistance && !Julia)
+                derC = slope * derC + Value_type{ 1 };
 
-                    // generate number [0x00, 0xff]
-                    const auto getColor{ [&iter, &value, &iteration](Value_type mul) -> unsigned char {
-                        if (iter == iteration)
-                            return 0x00;
+            Z = Cell_type{ lowerReal, lowerImag } * Z + c;
+        }
 
-                        // auto&  R{ value };
-                        // auto   V{ std::max(0.0, 2 * std::log(R) / std::pow(2, iter)) };    // [0,idk)
-                        // auto   x{ std::log(V) / std::log(1 + iter / 2) };
-                        auto   x{ iter };
+        return { squareModulus, static_cast<Iteration_type>(i) };
+    }
 
-                        constexpr Value_type offset{ 0.2 };
-                        const auto color{ static_cast<unsigned char>(0xff * (1 + (offset) / 2 - (1 - offset) * std::cos(mul * x)) / 2) };
-                        return color;
-                    } };
+    // lane flags and counters of the batched kernel have the width of U so they share the vector layout of the coordinates
+    template <typename U>
+    using Mask_type = std::conditional_t<sizeof(U) == sizeof(std::int32_t), std::int32_t, std::int64_t>;
 
-                    unsigned char r{ getColor(1 / (7.0 * std::pow(3.0, 0.25))) };
-                    unsigned char g{ getColor(1 / (3.0 * std::sqrt(2.0))) };
-                    unsigned char b{ getColor(1 / (2.0 * std::log(5.0))) };
-                    unsigned char a{ 0xff };
+    // per-lane state of the batched kernel, kept between calls when an iteration limit is raised (see ResumeState)
+    template <typename U>
+    struct BatchState
+    {
+        std::array<U, s_batchLanes<U>>            zReal;
+        std::array<U, s_batchLanes<U>>            zImag;
+        std::array<U, s_batchLanes<U>>            derReal;
+        std::array<U, s_batchLanes<U>>            derImag;
+        std::array<Mask_type<U>, s_batchLanes<U>> active;      // still iterating
+        std::array<Mask_type<U>, s_batchLanes<U>> interior;    // caught by the derivative test
+        std::array<Mask_type<U>, s_batchLanes<U>> count;
 
-                    m_texture.base()[start] = { r, g, b, a };
-                }
-            }));
+        // Z = point, nothing iterated yet
+        void start(const std::array<U, s_batchLanes<U>>& pointReal, const std::array<U, s_batchLanes<U>>& pointImag)
+        {
+            zReal = pointReal;
+            zImag = pointImag;
+            derReal.fill(1);
+            derImag.fill(0);
+            active.fill(1);
+            interior.fill(0);
+            count.fill(0);
         }
+    };
+
+    // batched escape time: the same loop as iterate<false> (derivative factor included, see there) over s_batchLanes<U>
+    // points at once, written in plain arrays with branchless per-lane updates so that the compiler can keep every lane
+    // in vector registers. finished lanes are frozen and the batch stops once all lanes are done. juliaReal/juliaImag is
+    // the fixed c of Julia sets, unused otherwise. state is left with where every lane stopped
+    template <typename U, int Exponent = 2, bool Julia = false>
+    [[gnu::always_inline]] static inline void iterateBatch(
+        BatchState<U>&                               state,
+        const std::array<U, s_batchLanes<U>>&        pointReal,
+        const std::array<U, s_batchLanes<U>>&        pointImag,
+        std::size_t                                  iteration,
+        U                                            radius,
+        std::array<Iteration_type, s_batchLanes<U>>& result,
+        U                                            juliaReal = 0,
+        U                                            juliaImag = 0
+    )
+    {
+        state.start(pointReal, pointImag);
+        continueBatch<U, Exponent, Julia>(state, pointReal, pointImag, 0, iteration, radius, juliaReal, juliaImag);
+        getBatchResult(state, iteration, result);
+    }
+
+    // the loop of iterateBatch from iteration from, where every lane of state stopped, up to iteration
+    template <typename U, int Exponent = 2, bool Julia = false>
+    [[gnu::always_inline]] static inline void continueBatch(
+        BatchState<U>&                        state,
+        const std::array<U, s_batchLanes<U>>& pointReal,
+        const std::array<U, s_batchLanes<U>>& pointImag,
+        std::size_t                           from,
+        std::size_t                           iteration,
+        U                                     radius,
+        U                                     juliaReal = 0,
+        U                                     juliaImag = 0
+    )
+    {
+        constexpr std::size_t lanes{ s_batchLanes<U> };
+        constexpr U           eps{ 0.1 };
+
+        auto& [zReal, zImag, derReal, derImag, active, interior, count]{ state };
+
+        for (std::size_t i{ from }; i < iteration; ++i) {
+            Mask_type<U> alive{ 0 };
+            for (std::size_t l{ 0 }; l < lanes; ++l) {
+                const U zr{ zReal[l] };
+                const U zi{ zImag[l] };
 
-        for (auto& future : futures) {
-            future.wait();
+                // Z^(Exponent - 1), shared by the derivative and the next Z
+                U lr, li;
+                power<Exponent - 1>(zr, zi, lr, li);
+                const U dr{ Exponent * (derReal[l] * lr - derImag[l] * li) };
+                const U di{ Exponent * (derReal[l] * li + derImag[l] * lr) };
+
+                const Mask_type<U> escaped{ zr * zr + zi * zi > radius * radius };
+                const Mask_type<U> caught{ dr * dr + di * di < eps * eps };
+                const Mask_type<U> running{ active[l] & !escaped & !caught };
+
+                interior[l] |= active[l] & !escaped & caught;
+                count[l]    += running;
+                active[l]    = running;
+                derReal[l]   = running ? dr : derReal[l];
+                derImag[l]   = running ? di : derImag[l];
+                zReal[l]     = running ? lr * zr - li * zi + (Julia ? juliaReal : pointReal[l]) : zr;
+                zImag[l]     = running ? lr * zi + li * zr + (Julia ? juliaImag : pointImag[l]) : zi;
+                alive       |= running;
+            }
+            if (!alive)
+                break;
         }
+    }
 
+    // a lane escaping at iteration i ran i full iterations, lanes caught by the derivative test count as interior
+    template <typename U>
+    [[gnu::always_inline]] static inline void getBatchResult(
+        const BatchState<U>&                         state,
+        std::size_t                                  iteration,
+        std::array<Iteration_type, s_batchLanes<U>>& result
+    )
+    {
+        for (std::size_t l{ 0 }; l < s_batchLanes<U>; ++l)
+            result[l] = static_cast<Iteration_type>(state.interior[l] ? static_cast<Mask_type<U>>(iteration) : state.count[l]);
+    }
+
+    TextureData_type& generateTexture(std::size_t iteration, Value_type radius = 1000.0)
+    {
+        const ViewParams view{ getViewParams(iteration, radius) };
+        m_usingFloat = useFloatKernel(view);
+        render(view, m_texture.base(), m_iterations.base(), &m_resume);
+        markRendered(view);
         return m_texture;
     }
 
+    // same as above but the image goes to pixels (e.g. a mapped pixel buffer) instead of the engine's texture data
+    void generateTexture(std::size_t iteration, Value_type radius, std::span<Pixel_type> pixels)
+    {
+        const ViewParams view{ getViewParams(iteration, radius) };
+        m_usingFloat = useFloatKernel(view);
+        render(view, pixels, m_iterations.base(), &m_resume);
+        markRendered(view);
+    }
+
+    // ColorMode::shader: iteration counts of the current view, clamped to 16 bits, for the fragment shader to colour
+    CountData_type& generateCounts(std::size_t iteration, Value_type radius = 1000.0)
+    {
+        const ViewParams view{ getViewParams(iteration, radius) };
+        m_usingFloat = useFloatKernel(view);
+        render(view, {}, m_iterations.base(), &m_resume);
+        m_counts.zip(m_iterations, [](Count_type, Iteration_type iteration) {
+            constexpr Iteration_type maxCount{ std::numeric_limits<Count_type>::max() };
+            return static_cast<Count_type>(std::min(iteration, maxCount));
+        });
+        markRendered(view);
+        return m_counts;
+    }
+
+    // incremental version of generateTexture (generateCounts in ColorMode::shader) writing to the engine's own data:
+    // renders bands of rows for about budget ms (at least one band) and returns, the next call continues where this one
+    // stopped. a new view or new settings start over from the row reached so far, wrapping around at the bottom, so
+    // that continuous navigation keeps refreshing the whole image. histogram colouring and anti-aliasing need the
+    // complete image and run (unbudgeted) with the last band. returns true once the view is complete, the written bands
+    // are reported by takeDirtyRegions()
+    bool generateStep(std::size_t iteration, Value_type radius, double budget)
+    {
+        util::Timer timer{ "generateStep", false };
+
+        const ViewParams view{ getViewParams(iteration, radius) };
+        if (m_settingsChanged || !m_progress || m_progress->view != view) {
+            const std::size_t startRow{ m_progress ? (m_progress->startRow + m_progress->rowsDone) % view.height : 0 };
+            m_progress.emplace(view, startRow);
+            m_pendingStore    = std::nullopt;
+            m_lastView        = std::nullopt;
+            m_settingsChanged = false;
+            m_usingFloat      = useFloatKernel(view);
+
+            // m_iterations is about to change, the resume points only stay valid until it does when the new view
+            // continues them
+            if (canResume(m_resume, view))
+                m_progress->resumeFrom = m_resume.view->iteration;
+            else
+                clearResume(m_resume);
+            m_resume.view = std::nullopt;
+
+            // histogram colouring previews the bands with the cosine palette until the histogram is known
+            if (m_colorMode == ColorMode::cosine || m_colorMode == ColorMode::histogram) {
+                Frame frame{ view, {}, {} };
+                buildCosinePalette(frame);
+                m_progress->palette = std::move(frame.palette);
+            }
+
+            // a cached view is complete right away, unless continuing the last one is cheaper still
+            Frame frame{ m_progress->view, m_colorMode != ColorMode::shader ? m_texture.base() : std::span<Pixel_type>{}, m_iterations.base() };
+            frame.palette = std::move(m_progress->palette);
+            if (!m_progress->resumeFrom && loadCached(frame)) {
+                colorizeCached(frame);
+                if (m_colorMode == ColorMode::shader)
+                    storeCounts(0, view.getLength());
+                m_progress->rowsDone = view.height;
+                m_progress->cached   = true;
+                m_dirtyRegions       = { util::Rect{ 0, 0, view.width, view.height } };
+            }
+            m_progress->palette = std::move(frame.palette);
+        }
+
+        auto& progress{ *m_progress };
+        if (progress.rowsDone == view.height && m_lastView)
+            return true;
+
+        const bool withPixels{ m_colorMode != ColorMode::shader };
+        Frame      frame{ progress.view, withPixels ? m_texture.base() : std::span<Pixel_type>{}, m_iterations.base() };
+        frame.palette = std::move(progress.palette);
+        findMirrors(frame);
+        if (!progress.resumeFrom && m_colorMode != ColorMode::distance)
+            frame.resume = &m_resume;
+
+        while (progress.rowsDone < view.height) {
+            const std::size_t row{ (progress.startRow + progress.rowsDone) % view.height };
+            const std::size_t maxRows{ std::min(view.height - progress.rowsDone, view.height - row) };
+            const double      remaining{ budget - timer.elapsed() };
+
+            std::size_t rows{ s_initialBandRows };
+            if (progress.rowTime > 0.0)
+                rows = static_cast<std::size_t>(std::max(remaining, 0.0) / progress.rowTime);
+            rows = std::clamp<std::size_t>(rows, 1, maxRows);
+
+            util::Timer bandTimer{ "band", false };
+            renderRows(frame, row, rows);
+            progress.rowTime   = bandTimer.elapsed() / static_cast<double>(rows);
+            progress.rowsDone += rows;
+            addDirtyRegion({ 0, row, view.width, rows });
+            if (timer.elapsed() >= budget)
+                break;
+        }
+
+        if (progress.rowsDone == view.height) {
+            if (!progress.cached && m_colorMode != ColorMode::distance)
+                finishResume(m_resume, view);
+            if (!progress.cached && !m_cacheStores)
+                m_pendingStore = getCacheKey(view);
+            else if (!progress.cached)
+                storeCached(frame);
+            if (m_colorMode == ColorMode::histogram)
+                colorizeHistogram(frame);
+            if (m_antiAliasing.enabled && withPixels)
+                antiAlias(frame);
+            if (m_colorMode == ColorMode::histogram || (m_antiAliasing.enabled && withPixels))
+                m_dirtyRegions = { util::Rect{ 0, 0, view.width, view.height } };
+            m_lastView = view;
+        }
+
+        progress.palette  = std::move(frame.palette);
+        progress.elapsed += timer.elapsed();
+        return progress.rowsDone == view.height;
+    }
+
+    // time a complete render of the view generateStep works on would take, extrapolated from the rows done so far
+    double getRenderTimeEstimate() const
+    {
+        if (!m_progress || m_progress->rowsDone == 0)
+            return 0.0;
+        return m_progress->elapsed / static_cast<double>(m_progress->rowsDone) * static_cast<double>(m_progress->view.height);
+    }
+
+    // fraction of the view generateStep has completed
+    double getProgress() const
+    {
+        if (!m_progress || m_progress->view.height == 0)
+            return 1.0;
+        return static_cast<double>(m_progress->rowsDone) / static_cast<double>(m_progress->view.height);
+    }
+
+    // whether the last generateTexture already shows this view with the current settings
+    bool isUpToDate(std::size_t iteration, Value_type radius) const
+    {
+        return !m_settingsChanged && m_lastView == getViewParams(iteration, radius);
+    }
+
+    // regions of the image written since the last call, to upload only what changed
+    std::vector<util::Rect> takeDirtyRegions()
+    {
+        return std::exchange(m_dirtyRegions, {});
+    }
+
+    // reentrant: several views can render concurrently on one engine as long as its settings are left alone meanwhile.
+    // pixels and iterations must hold view.width * view.height elements, pixels is left alone (and may be empty) in
+    // ColorMode::shader. with resume, iterations still holding the counts resume was left with and view only raising
+    // its limit, the pixels running at the old limit continue from where they stopped instead of the whole view being
+    // computed again. resume is left with the state of this render
+    void render(
+        const ViewParams&         view,
+        std::span<Pixel_type>     pixels,
+        std::span<Iteration_type> iterations,
+        ResumeState*              resume = nullptr
+    ) const
+    {
+        util::Timer timer{ "generateMandelbrotSet" };
+
+        Frame frame{ view, pixels, iterations };
+
+        // histogram colouring needs the whole image first, its palette is built after the kernel
+        if (m_colorMode == ColorMode::cosine)
+            buildCosinePalette(frame);
+
+        if (resume && canResume(*resume, view)) {
+            const std::size_t from{ resume->view->iteration };
+            resume->view = std::nullopt;
+            resumeRows(frame, *resume, from, 0, view.getLength());
+            finishResume(*resume, view);
+        } else if (loadCached(frame)) {
+            if (resume)
+                clearResume(*resume);
+            colorizeCached(frame);
+        } else {
+            if (resume) {
+                clearResume(*resume);
+                frame.resume = m_colorMode != ColorMode::distance ? resume : nullptr;
+            }
+            findMirrors(frame);
+            generateRows(frame, 0, view.height, [](std::size_t) { return false; });
+            if (frame.resume)
+                finishResume(*resume, view);
+            storeCached(frame);
+        }
+
+        if (m_colorMode == ColorMode::histogram)
+            colorizeHistogram(frame);
+
+        if (m_antiAliasing.enabled && m_colorMode != ColorMode::shader)
+            antiAlias(frame);
+    }
+
+    // same as above, for callers that only want the image
+    void render(const ViewParams& view, std::span<Pixel_type> pixels) const
+    {
+        // per-thread scratch, kept across calls (render is reentrant)
+        thread_local util::AlignedVector<Iteration_type> iterations;
+        iterations.resize(view.getLength());
+        render(view, pixels, iterations);
+    }
+
+    // render() in bands of bandRows full rows, pushing the region of every finished band into finished and closing it
+    // at the end. a full channel holds the render back until the consumer catches up, a closed one stops it after the
+    // band in progress. histogram colouring and anti-aliasing need the whole image, with those the bands are only
+    // pushed once it is complete
+    void renderBands(
+        const ViewParams&          view,
+        std::span<Pixel_type>      pixels,
+        std::span<Iteration_type>  iterations,
+        util::Channel<util::Rect>& finished,
+        std::size_t                bandRows = 16
+    ) const
+    {
+        bandRows = std::max<std::size_t>(bandRows, 1);
+        const auto pushBands{ [&] {
+            for (std::size_t row{ 0 }; row < view.height; row += bandRows) {
+                if (!finished.push({ 0, row, view.width, std::min(bandRows, view.height - row) }))
+                    return false;
+            }
+            return true;
+        } };
+
+        try {
+            const bool wholeImage{ m_colorMode == ColorMode::histogram || (m_antiAliasing.enabled && m_colorMode != ColorMode::shader) };
+            if (wholeImage) {
+                render(view, pixels, iterations);
+                pushBands();
+                finished.close();
+                return;
+            }
+
+            Frame frame{ view, pixels, iterations };
+            if (m_colorMode == ColorMode::cosine)
+                buildCosinePalette(frame);
+
+            if (loadCached(frame)) {
+                colorizeCached(frame);
+                pushBands();
+            } else {
+                findMirrors(frame);
+                bool stopped{ false };
+                for (std::size_t row{ 0 }; row < view.height && !stopped; row += bandRows) {
+                    const std::size_t rows{ std::min(bandRows, view.height - row) };
+                    generateRows(frame, row, row + rows, [row](std::size_t done) { return done < row; });
+                    stopped = !finished.push({ 0, row, view.width, rows });
+                }
+                if (!stopped)
+                    storeCached(frame);
+            }
+        } catch (...) {
+            finished.close();
+            throw;
+        }
+        finished.close();
+    }
+
+    // renderBands() on a background thread, the consumer takes the bands from the returned stream as they finish (e.g.
+    // to encode, upload or send band k while band k + 1 is computed). capacity is how many finished bands may wait for
+    // the consumer. the engine and its settings, pixels and iterations must stay alone until the stream is done
+    TileStream streamTiles(
+        const ViewParams&         view,
+        std::span<Pixel_type>     pixels,
+        std::span<Iteration_type> iterations,
+        std::size_t               bandRows = 16,
+        std::size_t               capacity = 4
+    ) const
+    {
+        auto  finished{ std::make_unique<util::Channel<util::Rect>>(capacity) };
+        auto& channel{ *finished };
+        auto  producer{ std::async(std::launch::async, [this, view, pixels, iterations, &channel, bandRows] {
+            renderBands(view, pixels, iterations, channel, bandRows);
+        }) };
+        return { view, pixels, iterations, std::move(finished), std::move(producer) };
+    }
+
+    // cosine palette, x is the (possibly rescaled) iteration count
+    static Pixel_type getColor(double x)
+    {
+        // generate number [0x00, 0xff]
+        const auto getChannel{ [&x](double mul) -> unsigned char {
+            constexpr double offset{ s_paletteOffset };
+            const auto       color{ static_cast<unsigned char>(0xff * (1 + (offset) / 2 - (1 - offset) * std::cos(mul * x)) / 2) };
+            return color;
+        } };
+
+        unsigned char r{ getChannel(s_paletteFrequency[0]) };
+        unsigned char g{ getChannel(s_paletteFrequency[1]) };
+        unsigned char b{ getChannel(s_paletteFrequency[2]) };
+        unsigned char a{ 0xff };
+
+        return { r, g, b, a };
+    }
+
+    // white at s_distanceShadingWidth pixels from the boundary and beyond, fading to black on it
+    static Pixel_type getDistanceColor(Value_type distance, Value_type delta)
+    {
+        const double  width{ s_distanceShadingWidth * static_cast<double>(delta) };
+        const double  t{ std::clamp(static_cast<double>(distance) / width, 0.0, 1.0) };
+        unsigned char v{ static_cast<unsigned char>(0xff * std::sqrt(t)) };
+        return { v, v, v, 0xff };
+    }
+
+    // whether the float kernel still resolves neighbouring pixels of the view
+    static bool hasFloatPrecision(const ViewParams& view)
+    {
+        const Value_type scale{ std::max<Value_type>({
+            2.0,
+            std::abs(view.xCenter) + 2 * view.getAspectRatio() / view.magnification,
+            std::abs(view.yCenter) + 2 / view.magnification,
+        }) };
+        return view.getDelta() > s_floatPrecisionMargin * std::numeric_limits<float>::epsilon() * scale;
+    }
+
+    bool useFloatKernel(const ViewParams& view) const
+    {
+        // the distance estimate keeps the scalar double kernel. the generic build doesn't vectorize the batch, float
+        // measured slower than double there
+        if (m_colorMode == ColorMode::distance || util::cpu::getIsa() == util::cpu::Isa::generic)
+            return false;
+        return m_floatFastPath && hasFloatPrecision(view);
+    }
+
     std::size_t                               getWidth() const { return m_width; }
     std::size_t                               getHeight() const { return m_height; }
     const std::pair<std::size_t, std::size_t> getDimension() const { return { m_width, m_height }; }
-    const Value_type                          getXDelta() const { return m_xDelta; }
-    const Value_type                          getYDelta() const { return m_yDelta; }
+    const Value_type                          getXDelta() const { return getViewParams(0).getDelta(); }
+    const Value_type                          getYDelta() const { return getViewParams(0).getDelta(); }
     const Value_type                          getXCenter() const { return m_xCenter; }
     const Value_type                          getYCenter() const { return m_yCenter; }
     const Value_type                          getMagnification() const { return m_magnification; }
+    const IterationData_type&                 getIterations() const { return m_iterations; }
+    const TextureData_type&                   getTexture() const { return m_texture; }
+    const CountData_type&                     getCounts() const { return m_counts; }
+    ColorMode                                 getColorMode() const { return m_colorMode; }
+    const Formula&                            getFormula() const { return m_formula; }
+    const AntiAliasing&                       getAntiAliasing() const { return m_antiAliasing; }
+    bool                                      isFloatFastPathEnabled() const { return m_floatFastPath; }
+    bool                                      isUsingFloat() const { return m_usingFloat; }
+
+    void setColorMode(ColorMode mode)
+    {
+        m_colorMode       = mode;
+        m_settingsChanged = true;
+    }
+
+    // the exponent is clamped to [2, s_maxExponent]
+    void setFormula(const Formula& formula)
+    {
+        m_formula          = formula;
+        m_formula.exponent = std::clamp(formula.exponent, 2, s_maxExponent);
+        m_settingsChanged  = true;
+    }
+
+    // cache for the iteration counts of finished views, nullptr to disable. the cache must outlive its use here
+    void setTileCache(TileCache* cache)
+    {
+        m_tileCache = cache;
+    }
+
+    // off while the view keeps changing: the views only shown for a frame are not worth storing. turning stores back
+    // on stores the last view finished in the meantime
+    void setCacheStores(bool enable)
+    {
+        m_cacheStores = enable;
+        if (enable && m_pendingStore && m_tileCache)
+            m_tileCache->store(*std::exchange(m_pendingStore, std::nullopt), m_iterations.base());
+    }
+
+    void setFloatFastPath(bool enable)
+    {
+        m_floatFastPath   = enable;
+        m_settingsChanged = true;
+    }
+
+    void setAntiAliasing(const AntiAliasing& antiAliasing)
+    {
+        m_antiAliasing    = antiAliasing;
+        m_settingsChanged = true;
+    }
 
     void modifyDimension(const std::size_t width, const std::size_t height)
     {
@@ -154,7 +922,15 @@ public:
         m_width  = width;
         m_height = height;
 
-        m_texture = { m_width, m_height };
+        // reuses the buffers, everything gets rewritten by the next render anyway
+        const bool grows{ m_width * m_height > m_iterations.base().capacity() };
+        clearResume(m_resume);
+        m_pendingStore = std::nullopt;
+        m_texture.resize(m_width, m_height);
+        m_iterations.resize(m_width, m_height);
+        m_counts.resize(m_width, m_height);
+        if (grows)
+            placeBuffers();
     }
 
     void modifyCenter(const Value_type xPos, const Value_type yPos)
@@ -167,6 +943,718 @@ public:
     {
         m_magnification *= magnitude;
     }
+
+    void modifyMagnification(const Value_type magnification)
+    {
+        m_magnification = magnification;
+    }
+
+private:
+    // after a complete render into m_iterations, which render() only stored when cache stores were on
+    void markRendered(const ViewParams& view)
+    {
+        m_pendingStore    = m_cacheStores ? std::nullopt : getCacheKey(view);
+        m_lastView        = view;
+        m_settingsChanged = false;
+        m_dirtyRegions    = { util::Rect{ 0, 0, view.width, view.height } };
+        m_progress        = std::nullopt;
+    }
+
+    // bands written one after the other are merged into one region
+    void addDirtyRegion(const util::Rect& region)
+    {
+        if (!m_dirtyRegions.empty()) {
+            auto& last{ m_dirtyRegions.back() };
+            if (last.x == region.x && last.width == region.width && last.y + last.height == region.y) {
+                last.height += region.height;
+                return;
+            }
+        }
+        m_dirtyRegions.push_back(region);
+    }
+
+    // everything the iteration counts of the view depend on, nothing when they can't come from the cache (no cache, or
+    // the distance estimate which needs more than the counts). the magnification is rounded to s_cacheKeyBits bits of
+    // mantissa and the centre to 1 / s_cachePositionSteps of a pixel, views closer than that share their counts
+    std::optional<TileCache::Key> getCacheKey(const ViewParams& view) const
+    {
+        if (!m_tileCache || m_colorMode == ColorMode::distance)
+            return std::nullopt;
+
+        int          exponent;
+        const double mantissa{ std::frexp(static_cast<double>(view.magnification), &exponent) };
+        const double magnification{ std::ldexp(std::round(std::ldexp(mantissa, s_cacheKeyBits)), exponent - s_cacheKeyBits) };
+        const double step{ 4.0 / static_cast<double>(view.height) / magnification / s_cachePositionSteps };
+
+        TileCache::Key key{
+            .xCenter       = std::round(static_cast<double>(view.xCenter) / step),    // in steps
+            .yCenter       = std::round(static_cast<double>(view.yCenter) / step),
+            .magnification = magnification,
+            .radius        = static_cast<double>(view.radius),
+            .width         = view.width,
+            .height        = view.height,
+            .iteration     = view.iteration,
+            .exponent      = m_formula.exponent,
+            .flags         = (m_formula.julia ? TileCache::julia : 0) | (useFloatKernel(view) ? TileCache::singleFloat : 0),
+        };
+        if (m_formula.julia) {
+            key.juliaReal = static_cast<double>(m_formula.juliaC.real());
+            key.juliaImag = static_cast<double>(m_formula.juliaC.imag());
+        }
+        return key;
+    }
+
+    bool loadCached(Frame& frame) const
+    {
+        const auto key{ getCacheKey(frame.view) };
+        if (!key)
+            return false;
+        const auto entry{ m_tileCache->find(*key, frame.view.getLength()) };
+        if (!entry)
+            return false;
+
+        // a corrupt entry is a miss, the render overwrites what was decoded. data can be damaged and still decode, the
+        // counts index the palette and must be within [0, view.iteration]
+        util::Timer timer{ "loadCached" };
+        if (!entry->getIterations(frame.iterations))
+            return false;
+
+        const auto        limit{ static_cast<Iteration_type>(frame.view.iteration) };
+        std::atomic<bool> valid{ true };
+        util::parallelChunks(frame.view.getLength(), [&frame, &valid, limit](std::size_t, std::size_t startPos, std::size_t endPos) {
+            const bool inRange{ std::all_of(frame.iterations.begin() + startPos, frame.iterations.begin() + endPos, [limit](Iteration_type count) {
+                return count >= 0 && count <= limit;
+            }) };
+            if (!inRange)
+                valid = false;
+        });
+        return valid;
+    }
+
+    void storeCached(const Frame& frame) const
+    {
+        if (!m_cacheStores)
+            return;
+        if (const auto key{ getCacheKey(frame.view) })
+            m_tileCache->store(*key, frame.iterations);
+    }
+
+    // NUMA first touch of freshly allocated buffers: each chunk's slice is written from that chunk's pinned worker, with
+    // the split of the whole image passes (render of a full view, colouring, histogram, anti-aliasing), so those passes
+    // hit pages of their own node. a banded generateStep splits every band over all chunks and still crosses nodes.
+    // reused allocations keep their pages where they are
+    void placeBuffers()
+    {
+        if (!util::numa::isEnabled())
+            return;
+        util::parallelChunks(m_width * m_height, [this](std::size_t, std::size_t startPos, std::size_t endPos) {
+            std::fill(m_texture.base().begin() + startPos, m_texture.base().begin() + endPos, Pixel_type{});
+            std::fill(m_iterations.base().begin() + startPos, m_iterations.base().begin() + endPos, 0);
+            std::fill(m_counts.base().begin() + startPos, m_counts.base().begin() + endPos, 0);
+        });
+    }
+
+    // what the kernel would have coloured for counts that came from the cache: the cosine palette, the other modes
+    // colour afterwards anyway
+    void colorizeCached(Frame& frame) const
+    {
+        if (frame.palette.empty() || frame.pixels.empty())
+            return;
+        colorizeRows(frame, 0, frame.view.height);
+    }
+
+    // pixels = palette[iterations] over rows [row, row + rows) of the frame
+    static void colorizeRows(Frame& frame, std::size_t row, std::size_t rows)
+    {
+        frame.getPixelRows(row, rows).zip(frame.getIterationRows(row, rows), [&palette = frame.palette](const Pixel_type&, Iteration_type iteration) {
+            return palette[iteration];
+        });
+    }
+
+    // ColorMode::shader: clamp the iteration counts of [startPos, endPos) to 16 bits
+    void storeCounts(std::size_t startPos, std::size_t endPos)
+    {
+        const std::span<Count_type>           counts{ m_counts.base().data() + startPos, endPos - startPos };
+        const std::span<const Iteration_type> iterations{ m_iterations.data().data() + startPos, endPos - startPos };
+        MatrixView<Count_type>{ counts, m_width, counts.size() / m_width }.zip(MatrixView<const Iteration_type>{ iterations, m_width, iterations.size() / m_width }, [](Count_type, Iteration_type iteration) {
+            constexpr Iteration_type maxCount{ std::numeric_limits<Count_type>::max() };
+            return static_cast<Count_type>(std::min(iteration, maxCount));
+        });
+    }
+
+    // whether view is the view of resume with a higher limit, rendered the same way
+    bool canResume(const ResumeState& resume, const ViewParams& view) const
+    {
+        if (!resume.view || m_colorMode == ColorMode::distance || view.iteration <= resume.view->iteration)
+            return false;
+        ViewParams previous{ *resume.view };
+        previous.iteration = view.iteration;
+        return previous == view && resume.formula == m_formula && resume.useFloat == useFloatKernel(view);
+    }
+
+    static void clearResume(ResumeState& resume)
+    {
+        resume.view = std::nullopt;
+        resume.points.clear();
+        resume.mirrored.clear();
+    }
+
+    // the points of a complete view: finished ones dropped, the conjugates of the points of mirrored rows added, back in
+    // position order (generateStep's bands wrap around)
+    void finishResume(ResumeState& resume, const ViewParams& view) const
+    {
+        auto&      points{ resume.points };
+        const auto byPos{ [](const ResumePoint& a, const ResumePoint& b) { return a.pos < b.pos; } };
+        const auto sortPoints{ [&] {
+            if (!std::is_sorted(points.begin(), points.end(), byPos))
+                std::sort(points.begin(), points.end(), byPos);
+        } };
+
+        std::erase_if(points, [](const ResumePoint& point) { return point.finished; });
+        sortPoints();
+
+        if (!resume.mirrored.empty()) {
+            const std::size_t width{ view.width };
+            const std::size_t count{ points.size() };
+            const auto        rowBegin{ [&](std::size_t row) {
+                const auto found{ std::lower_bound(points.begin(), points.begin() + static_cast<std::ptrdiff_t>(count), row * width, [](const ResumePoint& point, std::size_t pos) {
+                    return point.pos < pos;
+                }) };
+                return static_cast<std::size_t>(found - points.begin());
+            } };
+            for (const auto& [row, source] : resume.mirrored) {
+                for (std::size_t i{ rowBegin(source) }, end{ rowBegin(source + 1) }; i < end; ++i) {
+                    ResumePoint point{ points[i] };
+                    point.pos     = static_cast<std::uint32_t>(row * width + point.pos % width);
+                    point.zImag   = -point.zImag;
+                    point.derImag = -point.derImag;
+                    points.push_back(point);
+                }
+            }
+            resume.mirrored.clear();
+            sortPoints();
+        }
+
+        resume.view     = view;
+        resume.formula  = m_formula;
+        resume.useFloat = useFloatKernel(view);
+    }
+
+    // [startPos, endPos) of the frame raised from the limit from to the frame's one. pixels at the old limit that aren't
+    // resume points were caught by the derivative test and are interior at the new limit too, the points continue
+    // from their saved state. the pixels are coloured afterwards since escaped ones may not be in pixels yet
+    void resumeRows(Frame& frame, ResumeState& resume, std::size_t from, std::size_t startPos, std::size_t endPos) const
+    {
+        util::Timer timer{ "resumeRows" };
+
+        const std::size_t row{ startPos / frame.view.width };
+        const std::size_t rows{ (endPos - startPos) / frame.view.width };
+        const auto        oldLimit{ static_cast<Iteration_type>(from) };
+        const auto        newLimit{ static_cast<Iteration_type>(frame.view.iteration) };
+        frame.getIterationRows(row, rows).map([oldLimit, newLimit](Iteration_type iteration) {
+            return iteration == oldLimit ? newLimit : iteration;
+        });
+
+        const auto             byPos{ [](const ResumePoint& point, std::size_t pos) { return point.pos < pos; } };
+        const auto             first{ std::lower_bound(resume.points.begin(), resume.points.end(), startPos, byPos) };
+        const auto             last{ std::lower_bound(first, resume.points.end(), endPos, byPos) };
+        std::span<ResumePoint> points{ first, last };
+        if (resume.useFloat)
+            continueIterations<float>(frame, points, from);
+        else
+            continueIterations<double>(frame, points, from);
+
+        if (frame.palette.empty() || frame.pixels.empty())
+            return;
+        colorizeRows(frame, row, rows);
+    }
+
+    // one band of generateStep, rows [row, row + rows) of the frame
+    void renderRows(Frame& frame, std::size_t row, std::size_t rows)
+    {
+        const std::size_t startPos{ row * frame.view.width };
+        const std::size_t endPos{ (row + rows) * frame.view.width };
+
+        const auto& progress{ *m_progress };
+        if (progress.resumeFrom) {
+            resumeRows(frame, m_resume, *progress.resumeFrom, startPos, endPos);
+        } else {
+            generateRows(frame, row, row + rows, [&progress, height = frame.view.height](std::size_t done) {
+                return (done + height - progress.startRow) % height < progress.rowsDone;
+            });
+        }
+
+        if (m_colorMode == ColorMode::shader)
+            storeCounts(startPos, endPos);
+    }
+
+    // the formulas with real coefficients are symmetric about the real axis: the orbit of the conjugate of a point is the
+    // conjugate of its orbit, and the floating point operations of the kernels are exactly sign symmetric. rows whose
+    // imaginary parts are exact opposites then have the same counts and colours. a Julia set is symmetric that way only
+    // when its c is real
+    void findMirrors(Frame& frame) const
+    {
+        frame.mirrors.clear();
+        if (m_formula.julia && m_formula.juliaC.imag() != 0)
+            return;
+
+        // ys is increasing, pairs are found walking in from both ends
+        const auto& ys{ frame.ys };
+        bool        found{ false };
+        frame.mirrors.assign(ys.size(), s_noRow);
+        for (std::size_t low{ 0 }, high{ ys.size() }; high > 0 && low < high - 1;) {
+            if (-ys[low] == ys[high - 1]) {
+                frame.mirrors[low]      = high - 1;
+                frame.mirrors[high - 1] = low;
+                found                   = true;
+                ++low;
+                --high;
+            } else if (-ys[low] > ys[high - 1]) {
+                ++low;
+            } else {
+                --high;
+            }
+        }
+        if (!found)
+            frame.mirrors.clear();
+    }
+
+    // rows [startRow, endRow) of the frame. of two mirrored rows (see findMirrors) only one is computed: a row whose
+    // mirror is done already (isDone(row)) or comes first in the range is copied from it. the rest is computed in runs
+    // of consecutive rows
+    template <typename IsDone>
+    void generateRows(Frame& frame, std::size_t startRow, std::size_t endRow, IsDone&& isDone) const
+    {
+        const std::size_t width{ frame.view.width };
+        const bool        useFloat{ useFloatKernel(frame.view) };
+
+        std::vector<std::pair<std::size_t, std::size_t>> copies;    // (row, source row)
+        std::vector<std::pair<std::size_t, std::size_t>> runs;      // [first, last) rows to compute
+        for (std::size_t row{ startRow }; row < endRow; ++row) {
+            const std::size_t source{ frame.mirrors.empty() ? s_noRow : frame.mirrors[row] };
+            const bool        inRange{ source >= startRow && source < endRow };
+            if (source != s_noRow && (inRange ? source < row : isDone(source)))
+                copies.emplace_back(row, source);
+            else if (!runs.empty() && runs.back().second == row)
+                ++runs.back().second;
+            else
+                runs.emplace_back(row, row + 1);
+        }
+
+        for (const auto& [first, last] : runs) {
+            if (m_colorMode == ColorMode::distance)
+                generateDistance(frame, first * width, last * width);
+            else if (useFloat)
+                generateIterations<float>(frame, first * width, last * width);
+            else
+                generateIterations<double>(frame, first * width, last * width);
+        }
+
+        if (copies.empty())
+            return;
+        util::parallelChunks(copies.size(), [&frame, &copies, width](std::size_t, std::size_t first, std::size_t last) {
+            for (std::size_t i{ first }; i < last; ++i) {
+                const auto [row, source]{ copies[i] };
+                std::copy_n(frame.iterations.begin() + source * width, width, frame.iterations.begin() + row * width);
+                if (!frame.pixels.empty())
+                    std::copy_n(frame.pixels.begin() + source * width, width, frame.pixels.begin() + row * width);
+            }
+        });
+        if (frame.resume)
+            frame.resume->mirrored.insert(frame.resume->mirrored.end(), copies.begin(), copies.end());
+    }
+
+    // iteration counts of [begin, end) with the batched kernel computing in U, colouring through the frame's palette
+    // right away when it is already known. each chunk runs the kernel variant of the active instruction set
+    template <typename U>
+    void generateIterations(Frame& frame, std::size_t begin, std::size_t end) const
+    {
+        const auto        isa{ util::cpu::getIsa() };
+        const std::size_t chunkNumber{ util::defaultChunkNumber() };
+
+        // pixels still running at the limit, per chunk so that they come out by position
+        std::vector<std::vector<ResumePoint>> chunkStopped(frame.resume ? chunkNumber : 0);
+
+        dispatchFormula([&]<int Exponent, bool Julia>() {
+            util::parallelChunks(end - begin, chunkNumber, [this, &frame, &chunkStopped, isa, begin](std::size_t i, std::size_t startPos, std::size_t endPos) {
+                util::Timer timer{ std::format("chunk {}", i) };
+                startPos += begin;
+                endPos   += begin;
+
+                auto* stopped{ chunkStopped.empty() ? nullptr : &chunkStopped[i] };
+                switch (isa) {
+#ifdef UTIL_CPU_ISA_VARIANTS
+                case util::cpu::Isa::avx512: iterateRangeAvx512<U, Exponent, Julia>(frame, startPos, endPos, stopped); break;
+                case util::cpu::Isa::avx2: iterateRangeAvx2<U, Exponent, Julia>(frame, startPos, endPos, stopped); break;
+#endif
+                default: iterateRange<U, Exponent, Julia>(frame, startPos, endPos, stopped); break;
+                }
+            });
+        });
+
+        for (const auto& points : chunkStopped)
+            frame.resume->points.insert(frame.resume->points.end(), points.begin(), points.end());
+    }
+
+    // the resume points of a view iterated further, from the limit from up to the frame's one. each chunk runs the
+    // kernel variant of the active instruction set
+    template <typename U>
+    void continueIterations(Frame& frame, std::span<ResumePoint> points, std::size_t from) const
+    {
+        const auto isa{ util::cpu::getIsa() };
+
+        dispatchFormula([&]<int Exponent, bool Julia>() {
+            util::parallelChunks(points.size(), [this, &frame, points, from, isa](std::size_t, std::size_t begin, std::size_t end) {
+                const auto chunk{ points.subspan(begin, end - begin) };
+                switch (isa) {
+#ifdef UTIL_CPU_ISA_VARIANTS
+                case util::cpu::Isa::avx512: continueRangeAvx512<U, Exponent, Julia>(frame, chunk, from); break;
+                case util::cpu::Isa::avx2: continueRangeAvx2<U, Exponent, Julia>(frame, chunk, from); break;
+#endif
+                default: continueRange<U, Exponent, Julia>(frame, chunk, from); break;
+                }
+            });
+        });
+    }
+
+    // calls func.template operator()<Exponent, Julia>() with the kernel parameters of the active formula
+    template <typename Func, int Exponent = 2>
+    decltype(auto) dispatchFormula(Func&& func) const
+    {
+        if constexpr (Exponent < s_maxExponent) {
+            if (m_formula.exponent > Exponent)
+                return dispatchFormula<Func, Exponent + 1>(std::forward<Func>(func));
+        }
+        if (m_formula.julia)
+            return func.template operator()<Exponent, true>();
+        return func.template operator()<Exponent, false>();
+    }
+
+#ifdef UTIL_CPU_ISA_VARIANTS
+    // same code as iterateRange and continueRange, recompiled for wider vectors. those and the batch functions are
+    // force-inlined into these so that the whole hot loop picks up the target
+    template <typename U, int Exponent, bool Julia>
+    [[gnu::target("avx2,fma")]] void iterateRangeAvx2(Frame& frame, std::size_t startPos, std::size_t endPos, std::vector<ResumePoint>* stopped) const
+    {
+        iterateRange<U, Exponent, Julia>(frame, startPos, endPos, stopped);
+    }
+
+    template <typename U, int Exponent, bool Julia>
+    [[gnu::target("avx512f,avx512dq,fma,prefer-vector-width=512")]] void iterateRangeAvx512(Frame& frame, std::size_t startPos, std::size_t endPos, std::vector<ResumePoint>* stopped) const
+    {
+        iterateRange<U, Exponent, Julia>(frame, startPos, endPos, stopped);
+    }
+
+    template <typename U, int Exponent, bool Julia>
+    [[gnu::target("avx2,fma")]] void continueRangeAvx2(Frame& frame, std::span<ResumePoint> points, std::size_t from) const
+    {
+        continueRange<U, Exponent, Julia>(frame, points, from);
+    }
+
+    template <typename U, int Exponent, bool Julia>
+    [[gnu::target("avx512f,avx512dq,fma,prefer-vector-width=512")]] void continueRangeAvx512(Frame& frame, std::span<ResumePoint> points, std::size_t from) const
+    {
+        continueRange<U, Exponent, Julia>(frame, points, from);
+    }
+#endif
+
+    template <typename U, int Exponent, bool Julia>
+    [[gnu::always_inline]] inline void iterateRange(Frame& frame, std::size_t startPos, std::size_t endPos, std::vector<ResumePoint>* stopped) const
+    {
+        constexpr std::size_t lanes{ s_batchLanes<U> };
+        const U               juliaReal{ static_cast<U>(m_formula.juliaC.real()) };
+        const U               juliaImag{ static_cast<U>(m_formula.juliaC.imag()) };
+
+        BatchState<U>                     state;
+        std::array<U, lanes>              cReal;
+        std::array<U, lanes>              cImag;
+        std::array<Iteration_type, lanes> result;
+        for (std::size_t start{ startPos }; start < endPos; start += lanes) {
+            const std::size_t count{ std::min(lanes, endPos - start) };
+            for (std::size_t l{ 0 }; l < lanes; ++l) {
+                // pad a partial batch with its last point, the extra results are dropped
+                const std::size_t pos{ start + std::min(l, count - 1) };
+                const Cell_type   c{ frame.at(pos) };
+                cReal[l] = static_cast<U>(c.real());
+                cImag[l] = static_cast<U>(c.imag());
+            }
+
+            iterateBatch<U, Exponent, Julia>(state, cReal, cImag, frame.view.iteration, static_cast<U>(frame.view.radius), result, juliaReal, juliaImag);
+
+            for (std::size_t l{ 0 }; l < count; ++l) {
+                frame.iterations[start + l] = result[l];
+                if (!frame.palette.empty())
+                    frame.pixels[start + l] = frame.palette[result[l]];
+                if (stopped && state.active[l])
+                    stopped->push_back({ static_cast<std::uint32_t>(start + l), false, state.zReal[l], state.zImag[l], state.derReal[l], state.derImag[l] });
+            }
+        }
+    }
+
+    // iterateRange for resume points, every lane starts from the state its point stopped in at the limit from. the
+    // points are left with their new state, the pixels are coloured by resumeRows
+    template <typename U, int Exponent, bool Julia>
+    [[gnu::always_inline]] inline void continueRange(Frame& frame, std::span<ResumePoint> points, std::size_t from) const
+    {
+        constexpr std::size_t lanes{ s_batchLanes<U> };
+        const U               juliaReal{ static_cast<U>(m_formula.juliaC.real()) };
+        const U               juliaImag{ static_cast<U>(m_formula.juliaC.imag()) };
+
+        BatchState<U>                     state;
+        std::array<U, lanes>              cReal;
+        std::array<U, lanes>              cImag;
+        std::array<Iteration_type, lanes> result;
+        for (std::size_t start{ 0 }; start < points.size(); start += lanes) {
+            const std::size_t count{ std::min(lanes, points.size() - start) };
+            for (std::size_t l{ 0 }; l < lanes; ++l) {
+                // pad a partial batch with its last point, the extra results are dropped
+                const ResumePoint& point{ points[start + std::min(l, count - 1)] };
+                const Cell_type    c{ frame.at(point.pos) };
+                cReal[l]         = static_cast<U>(c.real());
+                cImag[l]         = static_cast<U>(c.imag());
+                state.zReal[l]   = static_cast<U>(point.zReal);
+                state.zImag[l]   = static_cast<U>(point.zImag);
+                state.derReal[l] = static_cast<U>(point.derReal);
+                state.derImag[l] = static_cast<U>(point.derImag);
+            }
+            state.active.fill(1);
+            state.interior.fill(0);
+            state.count.fill(static_cast<Mask_type<U>>(from));
+
+            continueBatch<U, Exponent, Julia>(state, cReal, cImag, from, frame.view.iteration, static_cast<U>(frame.view.radius), juliaReal, juliaImag);
+            getBatchResult(state, frame.view.iteration, result);
+
+            for (std::size_t l{ 0 }; l < count; ++l) {
+                ResumePoint& point{ points[start + l] };
+                frame.iterations[point.pos] = result[l];
+                point.finished              = !state.active[l];
+                point.zReal                 = state.zReal[l];
+                point.zImag                 = state.zImag[l];
+                point.derReal               = state.derReal[l];
+                point.derImag               = state.derImag[l];
+            }
+        }
+    }
+
+    static void buildCosinePalette(Frame& frame)
+    {
+        const std::size_t iteration{ frame.view.iteration };
+        frame.palette.resize(iteration + 1);
+        for (std::size_t i{ 0 }; i < iteration; ++i)
+            frame.palette[i] = getColor(static_cast<double>(i));
+        frame.palette[iteration] = s_interiorColor;
+    }
+
+    // distance estimation kernel. by the Koebe 1/4 theorem no point of the set lies within distance / 4 of an escaped
+    // point, so every pixel further than s_distanceShadingWidth pixels from the set inside that disk is plain white and
+    // is filled without the distance estimate. its escape count still comes from the plain kernel, so the iteration
+    // buffer holds real counts for anti-aliasing and streamed tiles. filling stays within the chunk of the computed
+    // pixel and only moves forward in scan order, so chunks never touch each other's pixels. only [begin, end) of the
+    // frame is written
+    void generateDistance(Frame& frame, std::size_t begin, std::size_t end) const
+    {
+        // per-thread scratch, named through a reference so the workers see the caller's one
+        thread_local util::AlignedVector<unsigned char> scratch;
+        auto&                                           filled{ scratch };
+        filled.assign(end - begin, false);
+        dispatchFormula([&]<int Exponent, bool Julia>() {
+            util::parallelChunks(end - begin, [this, &frame, &filled, begin](std::size_t i, std::size_t startPos, std::size_t endPos) {
+                util::Timer timer{ std::format("chunk {}", i) };
+                startPos += begin;
+                endPos   += begin;
+
+                const std::size_t width{ frame.view.width };
+                const std::size_t height{ frame.view.height };
+                const std::size_t iteration{ frame.view.iteration };
+
+                for (std::size_t start{ startPos }; start < endPos; start++) {
+                    if (filled[start - begin])
+                        continue;
+
+                    std::size_t xPos{ start % width };
+                    std::size_t yPos{ start / width };
+                    Cell_type   c{ frame.at(xPos, yPos) };
+
+                    const auto [value, iter, distance]{ iterate<true, Exponent, Julia>(c, iteration, frame.view.radius) };
+
+                    frame.iterations[start] = iter;
+                    frame.pixels[start]     = getDistanceColor(distance, frame.delta);
+
+                    // the disk argument needs a connected set, Julia sets can be dust
+                    if (Julia || iter == static_cast<Iteration_type>(iteration))
+                        continue;
+
+                    // radius (in pixels) of the disk whose pixels are all at least s_distanceShadingWidth pixels away
+                    const auto fillRadius{ static_cast<double>(distance / (4 * frame.delta)) - s_distanceShadingWidth };
+                    if (fillRadius < 1.0)
+                        continue;
+
+                    const auto        fillRadiusPx{ static_cast<std::ptrdiff_t>(fillRadius) };
+                    const std::size_t yEnd{ std::min(height, yPos + fillRadiusPx + 1) };
+                    for (std::size_t y{ yPos }; y < yEnd; ++y) {
+                        const auto dy{ static_cast<double>(y - yPos) };
+                        const auto halfWidth{ static_cast<std::ptrdiff_t>(std::sqrt(fillRadius * fillRadius - dy * dy)) };
+
+                        const auto xBegin{ static_cast<std::size_t>(std::max<std::ptrdiff_t>(0, static_cast<std::ptrdiff_t>(xPos) - halfWidth)) };
+                        const auto xEnd{ std::min(width, xPos + halfWidth + 1) };
+                        for (std::size_t x{ xBegin }; x < xEnd; ++x) {
+                            const std::size_t pos{ y * width + x };
+                            if (pos <= start || pos >= endPos || filled[pos - begin])
+                                continue;
+                            filled[pos - begin]   = true;
+                            frame.iterations[pos] = iterate<false, Exponent, Julia>(frame.at(x, y), iteration, frame.view.radius).iteration;
+                            frame.pixels[pos]     = getDistanceColor(std::numeric_limits<Value_type>::max(), frame.delta);
+                        }
+                    }
+                }
+            });
+        });
+    }
+
+    static std::vector<std::pair<Value_type, Value_type>> getSampleOffsets(SamplePattern pattern)
+    {
+        // offsets from the pixel centre, in pixels
+        switch (pattern) {
+        case SamplePattern::grid2x2:
+            return { { -0.25, -0.25 }, { 0.25, -0.25 }, { -0.25, 0.25 }, { 0.25, 0.25 } };
+        case SamplePattern::rotatedGrid4:
+            return { { -0.125, -0.375 }, { 0.375, -0.125 }, { 0.125, 0.375 }, { -0.375, 0.125 } };
+        case SamplePattern::grid4x4: {
+            std::vector<std::pair<Value_type, Value_type>> offsets;
+            for (int y{ 0 }; y < 4; ++y)
+                for (int x{ 0 }; x < 4; ++x)
+                    offsets.emplace_back((x - 1.5) / 4, (y - 1.5) / 4);
+            return offsets;
+        }
+        }
+        return {};
+    }
+
+    // adaptive supersampling: only pixels whose iteration count differs sharply from a 4-neighbour are resampled, flat
+    // regions keep their single sample. the resampled colour is the average of the centre and the pattern samples
+    void antiAlias(Frame& frame) const
+    {
+        util::Timer timer{ "antiAlias" };
+
+        const std::size_t length{ frame.view.getLength() };
+        const std::size_t width{ frame.view.width };
+        const std::size_t height{ frame.view.height };
+        const std::size_t chunkNumber{ util::defaultChunkNumber() };
+
+        // the contrast of every pixel to its 4-neighbours (edge pixels compare to themselves past the border), then the
+        // candidates are gathered tile by tile from the contiguous 64x64 blocks of the contrast matrix
+        ContrastData_type contrasts{ width, height };
+        contrasts.view().stencil(frame.getIterationRows(0, height), [](const auto& around) {
+            const Iteration_type iter{ around.center() };
+            return std::max({ std::abs(around(-1, 0) - iter), std::abs(around(1, 0) - iter), std::abs(around(0, -1) - iter), std::abs(around(0, 1) - iter) });
+        });
+
+        // (contrast, position) of every candidate pixel
+        std::vector<std::vector<std::pair<Iteration_type, std::size_t>>> chunkCandidates(chunkNumber);
+        util::parallelChunks(contrasts.getTileCount(), chunkNumber, [&](std::size_t i, std::size_t startTile, std::size_t endTile) {
+            for (std::size_t index{ startTile }; index < endTile; ++index) {
+                const auto tile{ std::as_const(contrasts).getTile(index) };
+                for (std::size_t y{ 0 }; y < tile.region.height; ++y) {
+                    for (std::size_t x{ 0 }; x < tile.region.width; ++x) {
+                        if (tile.at(x, y) > m_antiAliasing.threshold)
+                            chunkCandidates[i].emplace_back(tile.at(x, y), (tile.region.y + y) * width + tile.region.x + x);
+                    }
+                }
+            }
+        });
+
+        std::vector<std::pair<Iteration_type, std::size_t>> candidates;
+        for (auto& chunk : chunkCandidates)
+            candidates.insert(candidates.end(), chunk.begin(), chunk.end());
+
+        const auto maxPixels{ static_cast<std::size_t>(m_antiAliasing.maxPixelFraction * static_cast<double>(length)) };
+        if (candidates.size() > maxPixels) {
+            std::nth_element(candidates.begin(), candidates.begin() + maxPixels, candidates.end(), std::greater{});
+            candidates.resize(maxPixels);
+        }
+
+        const auto offsets{ getSampleOffsets(m_antiAliasing.pattern) };
+        dispatchFormula([&]<int Exponent, bool Julia>() {
+            util::parallelChunks(candidates.size(), chunkNumber, [&](std::size_t, std::size_t startIdx, std::size_t endIdx) {
+                for (std::size_t idx{ startIdx }; idx < endIdx; ++idx) {
+                    const std::size_t pos{ candidates[idx].second };
+                    const Cell_type   center{ frame.at(pos) };
+
+                    std::array<unsigned int, 4> sum{};
+                    const auto                  accumulate{ [&sum](const Pixel_type& color) {
+                        for (std::size_t ch{ 0 }; ch < sum.size(); ++ch)
+                            sum[ch] += color[ch];
+                    } };
+
+                    accumulate(frame.pixels[pos]);
+                    for (const auto& [xOffset, yOffset] : offsets) {
+                        const Cell_type c{ center + Cell_type{ xOffset * frame.delta, yOffset * frame.delta } };
+                        if (m_colorMode == ColorMode::distance)
+                            accumulate(getDistanceColor(iterate<true, Exponent, Julia>(c, frame.view.iteration, frame.view.radius).distance, frame.delta));
+                        else
+                            accumulate(frame.palette[iterate<false, Exponent, Julia>(c, frame.view.iteration, frame.view.radius).iteration]);
+                    }
+
+                    Pixel_type& pixel{ frame.pixels[pos] };
+                    for (std::size_t ch{ 0 }; ch < sum.size(); ++ch)
+                        pixel[ch] = static_cast<unsigned char>(sum[ch] / (offsets.size() + 1));
+                }
+            });
+        });
+    }
+
+    // histogram equalization over the iteration buffer, every step is split over the same chunks as the kernel:
+    //  1. per-chunk histograms of the escaped pixels
+    //  2. merge the histograms and scan the bins, each chunk owning a range of bins
+    //  3. add the scanned chunk totals as offsets to get the cumulative histogram
+    //  4. turn the cumulative histogram into the palette, then map every pixel through it
+    static void colorizeHistogram(Frame& frame)
+    {
+        util::Timer timer{ "colorizeHistogram" };
+
+        const std::size_t length{ frame.view.getLength() };
+        const std::size_t iteration{ frame.view.iteration };
+        const std::size_t chunkNumber{ util::defaultChunkNumber() };
+
+        std::vector<std::vector<std::size_t>> histograms(chunkNumber, std::vector<std::size_t>(iteration, 0));
+        util::parallelChunks(length, chunkNumber, [&frame, &histograms, iteration](std::size_t i, std::size_t startPos, std::size_t endPos) {
+            auto& histogram{ histograms[i] };
+            for (std::size_t pos{ startPos }; pos < endPos; ++pos) {
+                const auto iter{ static_cast<std::size_t>(frame.iterations[pos]) };
+                if (iter < iteration)
+                    ++histogram[iter];
+            }
+        });
+
+        std::vector<std::size_t> cumulative(iteration, 0);
+        std::vector<std::size_t> chunkTotals(chunkNumber, 0);
+        util::parallelChunks(iteration, chunkNumber, [&histograms, &cumulative, &chunkTotals](std::size_t i, std::size_t startBin, std::size_t endBin) {
+            std::size_t running{ 0 };
+            for (std::size_t bin{ startBin }; bin < endBin; ++bin) {
+                for (const auto& histogram : histograms)
+                    running += histogram[bin];
+                cumulative[bin] = running;
+            }
+            chunkTotals[i] = running;
+        });
+
+        // exclusive scan over chunkNumber values, not worth parallelizing
+        std::vector<std::size_t> chunkOffsets(chunkNumber, 0);
+        for (std::size_t i{ 1 }; i < chunkNumber; ++i)
+            chunkOffsets[i] = chunkOffsets[i - 1] + chunkTotals[i - 1];
+        const std::size_t total{ chunkOffsets.back() + chunkTotals.back() };
+
+        const double scale{ total > 0 ? s_histogramPaletteSpan / static_cast<double>(total) : 0.0 };
+        auto&        palette{ frame.palette };
+        palette.resize(iteration + 1);
+        palette[iteration] = s_interiorColor;
+        util::parallelChunks(iteration, chunkNumber, [&palette, &cumulative, &chunkOffsets, scale](std::size_t i, std::size_t startBin, std::size_t endBin) {
+            for (std::size_t bin{ startBin }; bin < endBin; ++bin)
+                palette[bin] = getColor(static_cast<double>(cumulative[bin] + chunkOffsets[i]) * scale);
+        });
+
+        colorizeRows(frame, 0, frame.view.height);
+    }
 };
 
 #endif
@@ -0,0 +1,110 @@
+#ifndef MATRIX_LAYOUT_H
+#define MATRIX_LAYOUT_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include "util/rect.hpp"
+
+// storage orders for UnrolledMatrix. every layout splits the image into tiles that are each one contiguous run of
+// storage, laid out tile after tile. (x, y) addressing goes through getIndex so callers don't care which one is used
+//
+//  - RowMajor: bands of full rows, the plain layout that can be uploaded as is
+//  - Tiled:    TileSize x TileSize blocks, row-major inside, padded to whole tiles at the right and bottom edges
+//  - Morton:   as Tiled but Z-order inside the tile, so every aligned 2x2, 4x4, ... block is contiguous (downsampling)
+namespace layout
+{
+    template <std::size_t BandRows = 16>
+    struct RowMajor
+    {
+        static constexpr bool s_isRowMajor{ true };
+        static constexpr bool s_hasContiguousTileRows{ true };
+
+        static std::size_t getStorageSize(std::size_t width, std::size_t height) { return width * height; }
+
+        static std::size_t getIndex(std::size_t x, std::size_t y, std::size_t width, std::size_t)
+        {
+            return y * width + x;
+        }
+
+        static std::size_t getTileCount(std::size_t, std::size_t height) { return (height + BandRows - 1) / BandRows; }
+
+        static util::Rect getTileRegion(std::size_t tile, std::size_t width, std::size_t height)
+        {
+            const std::size_t y{ tile * BandRows };
+            return { 0, y, width, std::min(BandRows, height - y) };
+        }
+
+        static std::size_t getTileOffset(std::size_t tile, std::size_t width, std::size_t) { return tile * BandRows * width; }
+        static std::size_t getTileStorageSize(const util::Rect& region) { return region.getArea(); }
+
+        // index within the tile, tileWidth is the width of the tile's region
+        static std::size_t getLocalIndex(std::size_t x, std::size_t y, std::size_t tileWidth) { return y * tileWidth + x; }
+    };
+
+    template <std::size_t TileSize, typename Derived>
+    struct BlockedBase
+    {
+        static constexpr bool s_isRowMajor{ false };
+
+        static std::size_t getTilesX(std::size_t width) { return (width + TileSize - 1) / TileSize; }
+        static std::size_t getTilesY(std::size_t height) { return (height + TileSize - 1) / TileSize; }
+
+        static std::size_t getStorageSize(std::size_t width, std::size_t height)
+        {
+            return getTilesX(width) * getTilesY(height) * TileSize * TileSize;
+        }
+
+        static std::size_t getIndex(std::size_t x, std::size_t y, std::size_t width, std::size_t)
+        {
+            const std::size_t tile{ (y / TileSize) * getTilesX(width) + x / TileSize };
+            return tile * TileSize * TileSize + Derived::getLocalIndex(x % TileSize, y % TileSize, TileSize);
+        }
+
+        static std::size_t getTileCount(std::size_t width, std::size_t height) { return getTilesX(width) * getTilesY(height); }
+
+        static util::Rect getTileRegion(std::size_t tile, std::size_t width, std::size_t height)
+        {
+            const std::size_t x{ (tile % getTilesX(width)) * TileSize };
+            const std::size_t y{ (tile / getTilesX(width)) * TileSize };
+            return { x, y, std::min(TileSize, width - x), std::min(TileSize, height - y) };
+        }
+
+        static std::size_t getTileOffset(std::size_t tile, std::size_t, std::size_t) { return tile * TileSize * TileSize; }
+        static std::size_t getTileStorageSize(const util::Rect&) { return TileSize * TileSize; }    // padding included
+    };
+
+    template <std::size_t TileSize = 64>
+    struct Tiled : BlockedBase<TileSize, Tiled<TileSize>>
+    {
+        static constexpr bool s_hasContiguousTileRows{ true };
+
+        static std::size_t getLocalIndex(std::size_t x, std::size_t y, std::size_t) { return y * TileSize + x; }
+    };
+
+    template <std::size_t TileSize = 64>
+    struct Morton : BlockedBase<TileSize, Morton<TileSize>>
+    {
+        static_assert((TileSize & (TileSize - 1)) == 0, "Morton tiles need a power of two size");
+
+        static constexpr bool s_hasContiguousTileRows{ false };
+
+        // spread the bits of v apart: ...b2 b1 b0 -> ...0 b2 0 b1 0 b0
+        static std::uint32_t spreadBits(std::uint32_t v)
+        {
+            v = (v | (v << 8)) & 0x00ff00ff;
+            v = (v | (v << 4)) & 0x0f0f0f0f;
+            v = (v | (v << 2)) & 0x33333333;
+            v = (v | (v << 1)) & 0x55555555;
+            return v;
+        }
+
+        static std::size_t getLocalIndex(std::size_t x, std::size_t y, std::size_t)
+        {
+            return spreadBits(static_cast<std::uint32_t>(x)) | (spreadBits(static_cast<std::uint32_t>(y)) << 1);
+        }
+    };
+}
+
+#endif /* ifndef MATRIX_LAYOUT_H */
@@ -0,0 +1,277 @@
+#ifndef MATRIX_VIEW_H
+#define MATRIX_VIEW_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "./matrix_layout.h"
+#include "util/parallel.hpp"
+#include "util/rect.hpp"
+
+// non-owning width x height image over storage in Layout's order, which must hold Layout::getStorageSize(width, height)
+// elements. it carries the parallel passes of UnrolledMatrix, so that they also run on buffers the matrix doesn't own
+// (render frames, mapped pixel buffers). T is const for read-only views
+template <typename T, typename Layout = layout::RowMajor<>>
+class MatrixView
+{
+public:
+    using Element_type = T;
+    using Value_type   = std::remove_const_t<T>;
+    using Layout_type  = Layout;
+
+    // one tile of the storage: the pixels of region, contiguous in the layout's order (padding included)
+    struct Tile
+    {
+        util::Rect   region;
+        std::span<T> data;
+
+        // x and y relative to the tile's region
+        T& at(std::size_t x, std::size_t y) const { return data[Layout::getLocalIndex(x, y, region.width)]; }
+    };
+
+    class TileIterator
+    {
+    public:
+        using value_type        = Tile;
+        using difference_type   = std::ptrdiff_t;
+        using iterator_category = std::input_iterator_tag;
+
+        TileIterator() = default;
+
+        TileIterator(const MatrixView& view, std::size_t index)
+            : m_view{ view }
+            , m_index{ index }
+        {
+        }
+
+        Tile          operator*() const { return m_view.getTile(m_index); }
+        TileIterator& operator++()
+        {
+            ++m_index;
+            return *this;
+        }
+        TileIterator operator++(int)
+        {
+            auto copy{ *this };
+            ++m_index;
+            return copy;
+        }
+        bool operator==(const TileIterator& other) const { return m_index == other.m_index; }
+
+    private:
+        MatrixView  m_view{};
+        std::size_t m_index{};
+    };
+
+    struct TileRange
+    {
+        MatrixView view;
+
+        TileIterator begin() const { return { view, 0 }; }
+        TileIterator end() const { return { view, view.getTileCount() }; }
+    };
+
+    // 3x3 window handed to stencil callables, (0, 0) is the centre
+    struct Neighbourhood
+    {
+        MatrixView  view;
+        std::size_t x;
+        std::size_t y;
+
+        const Value_type& operator()(int dx, int dy) const
+        {
+            const auto col{ static_cast<std::size_t>(std::clamp<std::ptrdiff_t>(static_cast<std::ptrdiff_t>(x) + dx, 0, view.m_width - 1)) };
+            const auto row{ static_cast<std::size_t>(std::clamp<std::ptrdiff_t>(static_cast<std::ptrdiff_t>(y) + dy, 0, view.m_height - 1)) };
+            return view.m_data[Layout::getIndex(col, row, view.m_width, view.m_height)];
+        }
+
+        const Value_type& center() const { return (*this)(0, 0); }
+    };
+
+private:
+    std::span<T> m_data{};
+
+    std::size_t m_width{};
+    std::size_t m_height{};
+
+public:
+    MatrixView() = default;
+
+    MatrixView(
+        std::span<T> data,
+        std::size_t  width,
+        std::size_t  height
+    )
+        : m_data{ data }
+        , m_width{ width }
+        , m_height{ height }
+    {
+    }
+
+    // read-only view of a writable one
+    template <typename U>
+        requires std::is_same_v<const U, T> && (!std::is_same_v<U, T>)
+    MatrixView(const MatrixView<U, Layout>& view)
+        : m_data{ view.data() }
+        , m_width{ view.getSize().first }
+        , m_height{ view.getSize().second }
+    {
+    }
+
+    // parallel passes over the whole image, split over tiles. the callables are template parameters so they inline
+    // into the loops, which run over contiguous runs of storage (whole tiles or tile rows) and vectorize. they are
+    // called concurrently and must not touch shared state without synchronization
+
+    // element = func(element)
+    template <typename Func>
+    void map(Func&& func) const
+    {
+        forEachRun([this, &func](std::size_t, std::size_t offset, std::size_t length) {
+            T* elements{ m_data.data() + offset };
+            for (std::size_t i{ 0 }; i < length; ++i)
+                elements[i] = func(elements[i]);
+        });
+    }
+
+    // element = func(element, otherElement), other must have the same dimensions
+    template <typename U, typename Func>
+    void zip(const MatrixView<U, Layout>& other, Func&& func) const
+    {
+        checkSize(other);
+        forEachRun([this, &other, &func](std::size_t, std::size_t offset, std::size_t length) {
+            T*       elements{ m_data.data() + offset };
+            const U* others{ other.data().data() + offset };
+            for (std::size_t i{ 0 }; i < length; ++i)
+                elements[i] = func(elements[i], others[i]);
+        });
+    }
+
+    // combine of func(element) over all elements, identity must be neutral for combine (every chunk starts from it)
+    template <typename R, typename Func, typename Combine = std::plus<>>
+    R reduce(R identity, Func&& func, Combine&& combine = {}) const
+    {
+        const std::size_t chunkNumber{ util::defaultChunkNumber() };
+        std::vector<R>    partials(chunkNumber, identity);
+        forEachRun(chunkNumber, [this, &partials, &func, &combine](std::size_t chunk, std::size_t offset, std::size_t length) {
+            const T* elements{ m_data.data() + offset };
+            R        partial{ partials[chunk] };
+            for (std::size_t i{ 0 }; i < length; ++i)
+                partial = combine(partial, func(elements[i]));
+            partials[chunk] = partial;
+        });
+
+        R result{ identity };
+        for (const auto& partial : partials)
+            result = combine(result, partial);
+        return result;
+    }
+
+    // element(x, y) = func(neighbourhood), a 3x3 window of source centred on (x, y) clamped at the edges. source must
+    // have the same dimensions and not overlap this view, its layout may differ
+    template <typename U, typename SourceLayout, typename Func>
+    void stencil(const MatrixView<U, SourceLayout>& source, Func&& func) const
+    {
+        checkSize(source);
+        using Source_type = MatrixView<const std::remove_const_t<U>, SourceLayout>;
+        const Source_type window{ source };
+        util::parallelChunks(getTileCount(), [this, &window, &func](std::size_t, std::size_t startTile, std::size_t endTile) {
+            for (std::size_t index{ startTile }; index < endTile; ++index) {
+                const auto tile{ getTile(index) };
+                for (std::size_t y{ 0 }; y < tile.region.height; ++y) {
+                    for (std::size_t x{ 0 }; x < tile.region.width; ++x)
+                        tile.at(x, y) = func(typename Source_type::Neighbourhood{ window, tile.region.x + x, tile.region.y + y });
+                }
+            }
+        });
+    }
+
+    T& operator()(std::size_t col, std::size_t row) const { return m_data[Layout::getIndex(col, row, m_width, m_height)]; }
+
+    // return pair of width, height
+    std::pair<std::size_t, std::size_t> getSize() const { return { m_width, m_height }; }
+
+    std::size_t getLength() const { return m_width * m_height; }
+
+    std::span<T> data() const { return m_data; }
+
+    std::size_t getTileCount() const { return Layout::getTileCount(m_width, m_height); }
+
+    Tile getTile(std::size_t index) const
+    {
+        const util::Rect region{ Layout::getTileRegion(index, m_width, m_height) };
+        return { region, m_data.subspan(Layout::getTileOffset(index, m_width, m_height), Layout::getTileStorageSize(region)) };
+    }
+
+    // for (auto tile : view.tiles()) ..., tiles come in storage order
+    TileRange tiles() const { return { *this }; }
+
+    // row-major copy of the image (e.g. for upload), out must hold getLength() elements. tiles are copied in parallel
+    void copyToRowMajor(std::span<Value_type> out) const
+    {
+        if constexpr (Layout::s_isRowMajor) {
+            std::copy_n(m_data.begin(), getLength(), out.begin());
+        } else {
+            util::parallelChunks(getTileCount(), [this, out](std::size_t, std::size_t startTile, std::size_t endTile) {
+                for (std::size_t index{ startTile }; index < endTile; ++index) {
+                    const auto tile{ getTile(index) };
+                    const auto& [x, y, width, height]{ tile.region };
+                    for (std::size_t row{ 0 }; row < height; ++row) {
+                        auto* dest{ out.data() + (y + row) * m_width + x };
+                        if constexpr (Layout::s_hasContiguousTileRows) {
+                            std::copy_n(&tile.at(0, row), width, dest);
+                        } else {
+                            for (std::size_t col{ 0 }; col < width; ++col)
+                                dest[col] = tile.at(col, row);
+                        }
+                    }
+                }
+            });
+        }
+    }
+
+private:
+    template <typename U, typename OtherLayout>
+    void checkSize(const MatrixView<U, OtherLayout>& other) const
+    {
+        if (other.getSize() != getSize())
+            throw std::invalid_argument{ "matrix dimensions differ" };
+    }
+
+    // func(chunk, offset, length) on every contiguous run of valid elements in storage, chunks run concurrently. a run
+    // is a whole tile when it has no padding, a tile row otherwise (single elements without contiguous rows)
+    template <typename Func>
+    void forEachRun(std::size_t chunkNumber, Func&& func) const
+    {
+        util::parallelChunks(getTileCount(), chunkNumber, [this, &func](std::size_t chunk, std::size_t startTile, std::size_t endTile) {
+            for (std::size_t index{ startTile }; index < endTile; ++index) {
+                const util::Rect  region{ Layout::getTileRegion(index, m_width, m_height) };
+                const std::size_t offset{ Layout::getTileOffset(index, m_width, m_height) };
+
+                if (Layout::getTileStorageSize(region) == region.getArea()) {
+                    func(chunk, offset, region.getArea());
+                } else if constexpr (Layout::s_hasContiguousTileRows) {
+                    for (std::size_t y{ 0 }; y < region.height; ++y)
+                        func(chunk, offset + Layout::getLocalIndex(0, y, region.width), region.width);
+                } else {
+                    for (std::size_t y{ 0 }; y < region.height; ++y)
+                        for (std::size_t x{ 0 }; x < region.width; ++x)
+                            func(chunk, offset + Layout::getLocalIndex(x, y, region.width), 1);
+                }
+            }
+        });
+    }
+
+    template <typename Func>
+    void forEachRun(Func&& func) const
+    {
+        forEachRun(util::defaultChunkNumber(), std::forward<Func>(func));
+    }
+};
+
+#endif /* ifndef MATRIX_VIEW_H */
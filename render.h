@@ -7,15 +7,24 @@
 #include <iostream>
 #include <vector>
 #include <array>
+#include <chrono>
 #include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <optional>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
 #include <tile/tile.h>
+#include <texture_header/texture_stream.h>
 
+#include "./buddhabrot.h"
+#include "./input_recording.h"
 #include "./mandelbrot_set.h"
 
+#include "util/parallel.hpp"
 #include "util/timer.hpp"
 
 namespace RenderEngine
@@ -31,8 +40,10 @@ namespace RenderEngine
     void resetCamera(bool = false);
     void processInput(GLFWwindow*);
     void updateStates();
+    void updateResolution(bool);
     void updateDeltaTime();
     void updateTitle();
+    double getTime();
 
     //=================================================================================================
 
@@ -42,12 +53,25 @@ namespace RenderEngine
     using Pixel_type       = std::array<unsigned char, 4>;
     using TextureData_type = UnrolledMatrix<Pixel_type>;
 
+    bool readsWholeImage();
+    Pixel_type* acquireStream();
+    void uploadTexture(const Pixel_type*, std::span<const util::Rect>);
+    void updateBuddhabrot(std::size_t, Value_type);
+    void recordInput();
+    InputState captureInput(double);
+    void applyInput(const InputState&);
+    void markUploaded(const Data_type::ViewParams&, std::span<const util::Rect>);
+    void drawTile(const Texture&, const Texture&);
+
     namespace configuration
     {
         int         width{ 800 };
         int         height{ 600 };
         float       aspectRatio{ 800 / static_cast<float>(600) };
         std::string windowName{ "Mandelbrot Set" };
+        bool        streamTexture{ true };    // upload through persistently mapped pixel buffers when supported
+        double      renderBudget{ 16.0 };     // ms of fractal computation per frame, 0 renders each view in one go
+        bool        headless{ false };        // replaying without a window, nothing is uploaded or drawn
     }
 
     namespace timing
@@ -84,13 +108,98 @@ namespace RenderEngine
         bool       pause{ false };
         int        iteration{ 5 };
         Value_type radius{ 100.0 };
+
+        std::size_t currentIteration{};    // iteration count of the last frame (zoom dependent)
+    }
+
+    // palette adjustments for Data_type::ColorMode::shader, applied as uniforms without re-rendering
+    namespace palette
+    {
+        float scale{ 1.0f };
+        float phase{ 0.0f };
+    }
+
+    // while the view moves, render at a reduced internal resolution whenever the last render went over the target. the
+    // tile quad stretches the result to the window, native resolution comes back once the view is idle. with a render
+    // budget the target is the time to complete an image, which then spans several frames
+    namespace resolution
+    {
+        double targetFrameTime{ 1000.0 / 30.0 };    // in ms, 0 disables scaling
+        double minScale{ 0.25 };
+        double step{ 0.125 };         // scale is quantized so the buffers are not reallocated every frame
+        double idleDelay{ 0.25 };     // seconds without view changes before going back to native resolution
+
+        double scale{ 1.0 };
+        double lastRenderTime{};    // in ms
+        double lastChange{};        // glfw time of the last view change
+    }
+
+    // orbit density view (B key), refined every frame while the view stays put
+    namespace buddhabrot
+    {
+        bool                    enabled{ false };
+        double                  samplesPerMs{ 1000.0 };    // measured, sizes each frame's batch to the render budget
+        std::vector<Pixel_type> image{};
+    }
+
+    // which view every row of the tile texture was rendered for. the texture is drawn band by band, each band where its
+    // part of the plane is in the current view, so a pan or zoom shows up on the next frame (stretched from what is
+    // already there) instead of when the new frame is done. rows not rendered for anything yet are not drawn
+    //
+    // a new size (dynamic resolution) retires the texture to its ping-pong partner instead of dropping it, the retired
+    // image is drawn under the new one until every row of that is rendered
+    namespace preview
+    {
+        struct RowView
+        {
+            Value_type    xCenter{};
+            Value_type    yCenter{};
+            Value_type    magnification{};
+            std::uint64_t generation{};    // increases with every new view, newer bands are drawn over older ones
+            bool          valid{ false };
+
+            bool operator==(const RowView&) const = default;
+        };
+
+        bool                 enabled{ true };
+        std::vector<RowView> rows{};
+        std::size_t          width{};
+        std::size_t          height{};
+        RowView              latest{};       // view of the last upload
+        Data_type::ColorMode colorMode{};    // mode and view kind the rows are for, the texture changes with them
+        bool                 buddhabrot{};
+
+        Texture*             retired{};          // partner of the tile texture
+        Texture*             retiredCounts{};    // partner of the iteration texture
+        std::vector<RowView> retiredRows{};
+        std::size_t          retiredWidth{};
+        std::size_t          retiredHeight{};
+    }
+
+    // session recording (--record), every change of the input driven state goes to file
+    namespace recording
+    {
+        std::ofstream             file{};
+        double                    startTime{};
+        std::optional<InputState> last{};
+    }
+
+    // headless replay (--replay), the clock runs in real time minus the idle stretches skipped
+    namespace replaying
+    {
+        std::chrono::steady_clock::time_point start{};
+        double                                skipped{};    // in seconds
     }
 
     namespace data
     {
-        Data_type*  dataPtr{};
-        GLFWwindow* window{};
-        Tile*       tile{};
+        Data_type*     dataPtr{};
+        GLFWwindow*    window{};
+        Tile*          tile{};
+        TextureStream* stream{};
+        Texture*       iterationTexture{};    // GL_R16 iteration counts for Data_type::ColorMode::shader
+
+        Buddhabrot<Value_type>* buddhabrot{};
     }
 
     //=================================================================================================
@@ -115,6 +224,27 @@ namespace RenderEngine
             "./resources/shaders/shader.fs",    // Shader
             { '\00', '\00', '\00' }             // Texture
         };
+        data::tile->m_texture.setMipmapGeneration(false);    // drawn at window size, minification never happens
+        data::tile->m_texture.updateFilters(GL_LINEAR, GL_LINEAR, GL_CLAMP_TO_EDGE);    // smooth when upscaled
+
+        // counts must not be interpolated across the interior boundary
+        data::iterationTexture = new Texture{};
+        data::iterationTexture->updateFilters(GL_NEAREST, GL_NEAREST, GL_CLAMP_TO_EDGE);
+        data::iterationTexture->setMipmapGeneration(false);
+
+        preview::retired = new Texture{};
+        preview::retired->setMipmapGeneration(false);
+        preview::retired->updateFilters(GL_LINEAR, GL_LINEAR, GL_CLAMP_TO_EDGE);
+        preview::retiredCounts = new Texture{};
+        preview::retiredCounts->setMipmapGeneration(false);
+        preview::retiredCounts->updateFilters(GL_NEAREST, GL_NEAREST, GL_CLAMP_TO_EDGE);
+
+        if (configuration::streamTexture && glStorage::load((GLADloadproc)glfwGetProcAddress)) {
+            data::stream = new TextureStream{ configuration::width, configuration::height };
+            data::tile->m_texture.allocateStorage(configuration::width, configuration::height);
+        } else {
+            configuration::streamTexture = false;
+        }
 
         simulation::iteration = iteration;
         simulation::radius    = radius;
@@ -135,14 +265,32 @@ namespace RenderEngine
         // draw
         //------
         // use shader
-        data::tile->m_shader.use();
-        data::tile->draw();
+        const bool iterationInput{ data::dataPtr->getColorMode() == Data_type::ColorMode::shader && !buddhabrot::enabled };
+        auto&      shader{ data::tile->m_shader };
+        shader.use();
+        shader.setBool("iterationInput", iterationInput);
+        if (iterationInput) {
+            const auto& frequency{ Data_type::s_paletteFrequency };
+            const auto& interior{ Data_type::s_interiorColor };
+            // the counts are clamped to 16 bits, a larger limit would never be reached by the interior
+            constexpr std::size_t maxCount{ std::numeric_limits<Data_type::Count_type>::max() };
+            shader.setFloat("maxIteration", static_cast<float>(std::min(simulation::currentIteration, maxCount)));
+            shader.setVec3("paletteFrequency", frequency[0], frequency[1], frequency[2]);
+            shader.setFloat("paletteOffset", Data_type::s_paletteOffset);
+            shader.setFloat("paletteScale", palette::scale);
+            shader.setFloat("palettePhase", palette::phase);
+            shader.setVec3("interiorColor", interior[0] / 255.0f, interior[1] / 255.0f, interior[2] / 255.0f);
+            drawTile(*data::iterationTexture, *preview::retiredCounts);
+        } else {
+            drawTile(data::tile->m_texture, *preview::retired);
+        }
         glfwSwapBuffers(data::window);
         //------
 
         // input
         glfwPollEvents();
         processInput(data::window);
+        recordInput();
 
         // delta time
         updateDeltaTime();
@@ -262,6 +410,79 @@ namespace RenderEngine
         if (key == GLFW_KEY_R && action == GLFW_PRESS) {
             resetCamera(true);
         }
+
+        // toggle histogram colouring
+        if (key == GLFW_KEY_H && action == GLFW_PRESS) {
+            using ColorMode = Data_type::ColorMode;
+            auto mode{ data::dataPtr->getColorMode() == ColorMode::histogram ? ColorMode::cosine : ColorMode::histogram };
+            data::dataPtr->setColorMode(mode);
+        }
+
+        // toggle distance estimation shading
+        if (key == GLFW_KEY_E && action == GLFW_PRESS) {
+            using ColorMode = Data_type::ColorMode;
+            auto mode{ data::dataPtr->getColorMode() == ColorMode::distance ? ColorMode::cosine : ColorMode::distance };
+            data::dataPtr->setColorMode(mode);
+        }
+
+        // toggle colouring in the fragment shader
+        if (key == GLFW_KEY_G && action == GLFW_PRESS) {
+            using ColorMode = Data_type::ColorMode;
+            auto mode{ data::dataPtr->getColorMode() == ColorMode::shader ? ColorMode::cosine : ColorMode::shader };
+            data::dataPtr->setColorMode(mode);
+        }
+
+        // palette frequency and phase, only uniforms change (shader colouring)
+        if (key == GLFW_KEY_LEFT_BRACKET && action == GLFW_PRESS)
+            palette::scale /= 1.25f;
+        if (key == GLFW_KEY_RIGHT_BRACKET && action == GLFW_PRESS)
+            palette::scale *= 1.25f;
+        if (key == GLFW_KEY_MINUS && action == GLFW_PRESS)
+            palette::phase -= 1.0f;
+        if (key == GLFW_KEY_EQUAL && action == GLFW_PRESS)
+            palette::phase += 1.0f;
+
+        // halve or double the base iteration count. raising it at a fixed view only continues the pixels still running
+        // at the old count
+        if (key == GLFW_KEY_COMMA && action == GLFW_PRESS)
+            simulation::iteration = std::max(simulation::iteration / 2, 1);
+        if (key == GLFW_KEY_PERIOD && action == GLFW_PRESS)
+            simulation::iteration *= 2;
+
+        // toggle the Julia set of the point at the centre of the view
+        if (key == GLFW_KEY_J && action == GLFW_PRESS) {
+            auto formula{ data::dataPtr->getFormula() };
+            formula.julia = !formula.julia;
+            if (formula.julia)
+                formula.juliaC = { view::position.x, view::position.y };
+            data::dataPtr->setFormula(formula);
+        }
+
+        // cycle the exponent of the iterated map (Multibrot)
+        if (key == GLFW_KEY_N && action == GLFW_PRESS) {
+            auto formula{ data::dataPtr->getFormula() };
+            formula.exponent = formula.exponent < Data_type::s_maxExponent ? formula.exponent + 1 : 2;
+            data::dataPtr->setFormula(formula);
+        }
+
+        // toggle the orbit density view
+        if (key == GLFW_KEY_B && action == GLFW_PRESS) {
+            buddhabrot::enabled = !buddhabrot::enabled;
+            if (!buddhabrot::enabled)
+                data::dataPtr->setColorMode(data::dataPtr->getColorMode());    // the texture holds the density, redo it
+        }
+
+        // toggle float kernel for shallow zooms
+        if (key == GLFW_KEY_F && action == GLFW_PRESS) {
+            data::dataPtr->setFloatFastPath(!data::dataPtr->isFloatFastPathEnabled());
+        }
+
+        // toggle adaptive anti-aliasing
+        if (key == GLFW_KEY_X && action == GLFW_PRESS) {
+            auto antiAliasing{ data::dataPtr->getAntiAliasing() };
+            antiAliasing.enabled = !antiAliasing.enabled;
+            data::dataPtr->setAntiAliasing(antiAliasing);
+        }
     }
 
     int shouldClose()
@@ -284,10 +505,21 @@ namespace RenderEngine
     void updateStates()
     {
         util::Timer timer{ "updateStates" };
+        {
+            static std::array<Value_type, 3> lastView{};
+            const std::array<Value_type, 3>  currentView{ view::position.x, view::position.y, view::zoom };
+            updateResolution(currentView != lastView);
+            lastView = currentView;
+
+            // views only passed through while navigating are not stored in the tile cache
+            data::dataPtr->setCacheStores(getTime() - resolution::lastChange > resolution::idleDelay);
+        }
         {
             // update dimension and position
             util::Timer timer1{ "modifyDimension and Center" };
-            data::dataPtr->modifyDimension(configuration::width, configuration::height);
+            const auto width{ std::max(1, static_cast<int>(configuration::width * resolution::scale)) };
+            const auto height{ std::max(1, static_cast<int>(configuration::height * resolution::scale)) };
+            data::dataPtr->modifyDimension(width, height);
             data::dataPtr->modifyCenter(view::position.x, view::position.y);
         }
 
@@ -295,25 +527,258 @@ namespace RenderEngine
         auto iteration{ simulation::iteration * std::sqrt(std::log(1 + view::zoom)) };
         // auto  radius{ simulation::radius / std::sqrt(std::log(1 + view::zoom)) };
         auto  radius{ simulation::radius };
-        auto& imageData{ data::dataPtr->generateTexture(iteration, radius) };
-        auto* imageDataPtr{ &imageData.base().front().front() };
-        data::tile->m_texture.updateTexture(imageDataPtr, data::dataPtr->getWidth(), data::dataPtr->getHeight(), sizeof(Pixel_type));
+        simulation::currentIteration = iteration;
+        if (buddhabrot::enabled) {
+            updateBuddhabrot(iteration, radius);
+        } else if (!data::dataPtr->isUpToDate(iteration, radius) && configuration::renderBudget > 0.0) {
+            // a few bands per frame, the texture keeps showing the rest of the previous image until they are redone
+            data::dataPtr->generateStep(iteration, radius, configuration::renderBudget);
+            const auto regions{ data::dataPtr->takeDirtyRegions() };
+            markUploaded(data::dataPtr->getViewParams(iteration, radius), regions);
+            if (configuration::headless) {
+                // nothing to upload to
+            } else if (data::dataPtr->getColorMode() == Data_type::ColorMode::shader) {
+                const auto& counts{ data::dataPtr->getCounts() };
+                data::iterationTexture->updateTextureRegions(counts.data().data(), data::dataPtr->getWidth(), data::dataPtr->getHeight(), regions);
+            } else {
+                uploadTexture(data::dataPtr->getTexture().data().data(), regions);
+            }
+            resolution::lastRenderTime = data::dataPtr->getRenderTimeEstimate();
+        } else if (!data::dataPtr->isUpToDate(iteration, radius)) {
+            util::Timer renderTimer{ "render", false };
+            const util::Rect whole{ 0, 0, data::dataPtr->getWidth(), data::dataPtr->getHeight() };
+            markUploaded(data::dataPtr->getViewParams(iteration, radius), { &whole, 1 });
+            if (data::dataPtr->getColorMode() == Data_type::ColorMode::shader) {
+                // half the upload of RGBA8 and no colouring on the CPU, the (small) R16 image skips the pixel buffers
+                auto& counts{ data::dataPtr->generateCounts(iteration, radius) };
+                if (!configuration::headless)
+                    data::iterationTexture->updateTextureRegions(counts.base().data(), data::dataPtr->getWidth(), data::dataPtr->getHeight(), data::dataPtr->takeDirtyRegions());
+            } else if (auto* pixels{ readsWholeImage() ? nullptr : acquireStream() }) {
+                // render workers write straight into the mapped pixel buffer
+                data::dataPtr->generateTexture(iteration, radius, { pixels, data::dataPtr->getWidth() * data::dataPtr->getHeight() });
+                data::stream->commit(data::tile->m_texture, data::dataPtr->takeDirtyRegions());
+            } else {
+                auto& imageData{ data::dataPtr->generateTexture(iteration, radius) };
+                uploadTexture(imageData.base().data(), data::dataPtr->takeDirtyRegions());
+            }
+            resolution::lastRenderTime = renderTimer.elapsed();
+        }
 
         // output something
-        if (!util::Timer::s_doPrint) {
+        if (!util::Timer::s_doPrint && !configuration::headless) {
             std::cout << std::format("It : {}\n", (int)iteration);
             std::cout << std::format("Rad: {}\n", radius);
             std::cout << std::format("Mag: {}\n", data::dataPtr->getMagnification());
             std::cout << std::format("Dim: {} | {}\n", data::dataPtr->getWidth(), data::dataPtr->getHeight());
             std::cout << std::format("Loc: {} | {}\n", data::dataPtr->getXCenter(), data::dataPtr->getYCenter());
             std::cout << std::format("d  : {} | {}\n", data::dataPtr->getXDelta(), data::dataPtr->getYDelta());
+            std::cout << std::format("Prc: {}\n", data::dataPtr->isUsingFloat() ? "float" : "double");
+            std::cout << std::format("Scl: {} ({:.1f} ms) | {:.0f}%\n", resolution::scale, resolution::lastRenderTime, data::dataPtr->getProgress() * 100);
 
-            std::cout << "\033[6A";    // move cursor up 6 lines
+            std::cout << "\033[8A";    // move cursor up 8 lines
             std::cout << "\033[0J";    // clear from cursor to end of screen
         }
         updateTitle();
     }
 
+    // histogram colouring and anti-aliasing read the whole image back after the kernel, too slow on mapped memory
+    bool readsWholeImage()
+    {
+        return data::dataPtr->getColorMode() == Data_type::ColorMode::histogram || data::dataPtr->getAntiAliasing().enabled;
+    }
+
+    // mapped pixel buffer for the engine's image size, nullptr without a stream or when the buffer isn't mapped. the
+    // texture storage is resized with the stream either way, so the fallback upload only replaces its contents
+    Pixel_type* acquireStream()
+    {
+        if (!data::stream)
+            return nullptr;
+
+        const int width{ static_cast<int>(data::dataPtr->getWidth()) };
+        const int height{ static_cast<int>(data::dataPtr->getHeight()) };
+        if (data::stream->getWidth() != width || data::stream->getHeight() != height) {
+            data::stream->resize(width, height);
+            data::tile->m_texture.allocateStorage(width, height);
+        }
+        return reinterpret_cast<Pixel_type*>(data::stream->acquire());
+    }
+
+    // regions of the engine's image to the tile texture, copied through a mapped pixel buffer when streaming.
+    //
+    // the budgeted path renders into the engine's image and pays this copy, instead of rendering into the ring slot like
+    // a whole render does: a slot only holds what was written through it, while a step needs the bands of the earlier
+    // steps (mirrored rows are copied from them, anti-aliasing and histogram colouring read the whole image once the
+    // view is complete). the copy is only the rows rendered in the step and is split over the workers like the kernel
+    void uploadTexture(const Pixel_type* source, std::span<const util::Rect> regions)
+    {
+        if (configuration::headless)
+            return;
+
+        auto* pixels{ acquireStream() };
+        if (!pixels) {
+            data::tile->m_texture.updateTextureRegions(&source->front(), data::dataPtr->getWidth(), data::dataPtr->getHeight(), regions);
+            return;
+        }
+
+        // same layout as the image, only the regions are filled in
+        const std::size_t width{ data::dataPtr->getWidth() };
+        for (const auto& region : regions) {
+            util::parallelChunks(region.height, [source, pixels, width, &region](std::size_t, std::size_t startRow, std::size_t endRow) {
+                for (std::size_t y{ region.y + startRow }; y < region.y + endRow; ++y) {
+                    const std::size_t offset{ y * width + region.x };
+                    std::copy_n(source + offset, region.width, pixels + offset);
+                }
+            });
+        }
+        data::stream->commit(data::tile->m_texture, regions);
+    }
+
+    // the regions uploaded now hold view. a new colour mode or view kind means another texture, nothing drawn before is
+    // in it. a new size means a respecified texture: the last complete image is retired to the partner texture first
+    void markUploaded(const Data_type::ViewParams& view, std::span<const util::Rect> regions)
+    {
+        const auto mode{ data::dataPtr->getColorMode() };
+        const bool resized{ view.width != preview::width || view.height != preview::height };
+        if (resized || mode != preview::colorMode || buddhabrot::enabled != preview::buddhabrot) {
+            const bool sameKind{ mode == preview::colorMode && buddhabrot::enabled == preview::buddhabrot };
+            const bool complete{ std::all_of(preview::rows.begin(), preview::rows.end(), [](const auto& row) { return row.valid; }) };
+            if (!sameKind || configuration::headless) {
+                preview::retiredRows.clear();
+            } else if (resized && !preview::rows.empty() && (complete || preview::retiredRows.empty())) {
+                // an image left incomplete by another resize is dropped, the older complete one stays retired
+                const bool counts{ mode == Data_type::ColorMode::shader && !buddhabrot::enabled };
+                (counts ? data::iterationTexture : &data::tile->m_texture)->swapTexture(counts ? *preview::retiredCounts : *preview::retired);
+                preview::retiredRows   = std::move(preview::rows);
+                preview::retiredWidth  = preview::width;
+                preview::retiredHeight = preview::height;
+            }
+            preview::rows.assign(view.height, {});
+            preview::width      = view.width;
+            preview::height     = view.height;
+            preview::colorMode  = mode;
+            preview::buddhabrot = buddhabrot::enabled;
+        }
+
+        auto& latest{ preview::latest };
+        if (!latest.valid || latest.xCenter != view.xCenter || latest.yCenter != view.yCenter || latest.magnification != view.magnification)
+            latest = { view.xCenter, view.yCenter, view.magnification, latest.generation + 1, true };
+
+        for (const auto& region : regions) {
+            for (std::size_t y{ region.y }; y < region.y + region.height && y < preview::rows.size(); ++y)
+                preview::rows[y] = latest;
+        }
+        if (std::all_of(preview::rows.begin(), preview::rows.end(), [](const auto& row) { return row.valid; }))
+            preview::retiredRows.clear();
+    }
+
+    // valid runs of rows of a texture of width x height, see drawTile
+    void drawRows(const Texture& texture, const std::vector<preview::RowView>& rows, std::size_t width, std::size_t height)
+    {
+        auto&      shader{ data::tile->m_shader };
+        const auto current{ data::dataPtr->getViewParams(0) };
+
+        struct Run
+        {
+            std::size_t begin;
+            std::size_t end;
+        };
+        std::vector<Run> runs;
+        for (std::size_t begin{ 0 }; begin < rows.size();) {
+            std::size_t end{ begin + 1 };
+            while (end < rows.size() && rows[end] == rows[begin])
+                ++end;
+            if (rows[begin].valid)
+                runs.push_back({ begin, end });
+            begin = end;
+        }
+        std::stable_sort(runs.begin(), runs.end(), [&rows](const Run& a, const Run& b) {
+            return rows[a.begin].generation < rows[b.begin].generation;
+        });
+
+        // plane coordinates to normalized device coordinates of the current view
+        const auto currentDelta{ current.getDelta() };
+        const auto currentOrigin{ current.getOrigin() };
+        const auto toDeviceX{ [&](Value_type x) { return 2.0 * (x - currentOrigin.real()) / (currentDelta * current.width) - 1.0; } };
+        const auto toDeviceY{ [&](Value_type y) { return 2.0 * (y - currentOrigin.imag()) / (currentDelta * current.height) - 1.0; } };
+
+        const auto textureHeight{ static_cast<float>(height) };
+        for (const auto& [begin, end] : runs) {
+            const auto&                 row{ rows[begin] };
+            const Data_type::ViewParams shown{ row.xCenter, row.yCenter, row.magnification, width, height };
+            const auto                  delta{ shown.getDelta() };
+            const auto                  origin{ shown.getOrigin() };
+
+            const double left{ toDeviceX(origin.real()) };
+            const double right{ toDeviceX(origin.real() + delta * shown.width) };
+            const double bottom{ toDeviceY(origin.imag() + delta * begin) };
+            const double top{ toDeviceY(origin.imag() + delta * end) };
+
+            shader.setVec4("positionTransform", (right - left) / 2, (top - bottom) / 2, (right + left) / 2, (top + bottom) / 2);
+            shader.setVec4("texCoordsTransform", 1.0f, (end - begin) / textureHeight, 0.0f, begin / textureHeight);
+            data::tile->draw(texture);
+        }
+    }
+
+    // the texture band by band (runs of rows rendered for the same view), oldest first, each placed where its part of
+    // the plane is in the current view. the retired texture of the last size goes underneath while it is kept
+    void drawTile(const Texture& texture, const Texture& retired)
+    {
+        auto& shader{ data::tile->m_shader };
+        if (!preview::enabled || buddhabrot::enabled || preview::rows.empty()) {
+            shader.setVec4("positionTransform", 1.0f, 1.0f, 0.0f, 0.0f);
+            shader.setVec4("texCoordsTransform", 1.0f, 1.0f, 0.0f, 0.0f);
+            data::tile->draw(texture);
+            return;
+        }
+
+        if (!preview::retiredRows.empty())
+            drawRows(retired, preview::retiredRows, preview::retiredWidth, preview::retiredHeight);
+        drawRows(texture, preview::rows, preview::width, preview::height);
+    }
+
+    // progressive: a new view starts over, otherwise the next batch of orbits is added to the density
+    void updateBuddhabrot(std::size_t iteration, Value_type radius)
+    {
+        const auto view{ data::dataPtr->getViewParams(iteration, radius) };
+        if (!data::buddhabrot)
+            data::buddhabrot = new Buddhabrot<Value_type>{ view };
+        else if (data::buddhabrot->getView() != view)
+            data::buddhabrot->reset(view);
+
+        const double budget{ configuration::renderBudget > 0.0 ? configuration::renderBudget : resolution::targetFrameTime };
+        const auto   samples{ std::max<std::size_t>(1000, static_cast<std::size_t>(buddhabrot::samplesPerMs * budget)) };
+
+        util::Timer timer{ "buddhabrot", false };
+        data::buddhabrot->addSamples(samples);
+        buddhabrot::samplesPerMs = static_cast<double>(samples) / std::max(timer.elapsed(), 0.01);
+
+        buddhabrot::image.resize(view.getLength());
+        data::buddhabrot->toImage(buddhabrot::image);
+        const util::Rect region{ 0, 0, view.width, view.height };
+        markUploaded(view, { &region, 1 });
+        uploadTexture(buddhabrot::image.data(), { &region, 1 });
+        resolution::lastRenderTime = 0.0;    // always within budget, no need to scale down
+    }
+
+    void updateResolution(bool viewChanged)
+    {
+        const double now{ getTime() };
+        if (viewChanged)
+            resolution::lastChange = now;
+
+        if (resolution::targetFrameTime <= 0.0 || now - resolution::lastChange > resolution::idleDelay) {
+            resolution::scale = 1.0;
+            return;
+        }
+        if (resolution::lastRenderTime <= 0.0)
+            return;
+
+        // render time goes with the pixel count, that is with the square of the scale
+        auto ideal{ resolution::scale * std::sqrt(resolution::targetFrameTime / resolution::lastRenderTime) };
+        ideal             = std::floor(ideal / resolution::step) * resolution::step;
+        resolution::scale = std::clamp(ideal, resolution::minScale, 1.0);
+    }
+
     // for continuous input
     void processInput(GLFWwindow* window)
     {
@@ -341,7 +806,7 @@ namespace RenderEngine
     // record frame draw time
     void updateDeltaTime()
     {
-        float currentFrame{ static_cast<float>(glfwGetTime()) };
+        float currentFrame{ static_cast<float>(getTime()) };
         timing::deltaTime  = currentFrame - timing::lastFrame;
         timing::lastFrame  = currentFrame;
         timing::sumTime   += timing::deltaTime;
@@ -349,6 +814,9 @@ namespace RenderEngine
 
     void updateTitle()
     {
+        if (configuration::headless)
+            return;
+
         static int      counter{ 0 };
         static float    sum{ 0 };
         constexpr float timeInterval{ 1.0f };    // print every this time interval in seconds
@@ -366,6 +834,179 @@ namespace RenderEngine
             sum += timing::deltaTime;
         }
     }
+
+    // seconds, from glfw or from the replay clock when headless
+    double getTime()
+    {
+        if (!configuration::headless)
+            return glfwGetTime();
+
+        const std::chrono::duration<double> elapsed{ std::chrono::steady_clock::now() - replaying::start };
+        return elapsed.count() + replaying::skipped;
+    }
+
+    //=================================================================================================
+
+    // call after initialize(), returns false when the file can't be written
+    bool startRecording(const std::filesystem::path& path)
+    {
+        recording::file.open(path, std::ios::trunc);
+        if (!recording::file)
+            return false;
+
+        recording::file << inputRecording::s_header << '\n';
+        recording::startTime = getTime();
+        recording::last      = std::nullopt;
+        return true;
+    }
+
+    // once per frame after the input is processed, only changes are written
+    void recordInput()
+    {
+        if (!recording::file.is_open())
+            return;
+
+        const auto state{ captureInput(getTime() - recording::startTime) };
+        if (recording::last && recording::last->isSameState(state))
+            return;
+
+        inputRecording::write(recording::file, state);
+        recording::file.flush();    // the session usually ends by closing the window, keep what was recorded
+        recording::last = state;
+    }
+
+    InputState captureInput(double time)
+    {
+        const auto& formula{ data::dataPtr->getFormula() };
+        return {
+            .time          = time,
+            .xCenter       = view::position.x,
+            .yCenter       = view::position.y,
+            .magnification = view::zoom,
+            .width         = configuration::width,
+            .height        = configuration::height,
+            .colorMode     = static_cast<int>(data::dataPtr->getColorMode()),
+            .exponent      = formula.exponent,
+            .julia         = formula.julia,
+            .juliaReal     = formula.juliaC.real(),
+            .juliaImag     = formula.juliaC.imag(),
+            .antiAliasing  = data::dataPtr->getAntiAliasing().enabled,
+            .floatFastPath = data::dataPtr->isFloatFastPathEnabled(),
+            .buddhabrot    = buddhabrot::enabled,
+            .iteration     = simulation::iteration,
+        };
+    }
+
+    // what the callbacks would have done to get to state. settings are only touched when they differ, setting them
+    // restarts the render
+    void applyInput(const InputState& state)
+    {
+        view::position        = { state.xCenter, state.yCenter };
+        view::zoom            = state.magnification;
+        configuration::width  = state.width;
+        configuration::height = state.height;
+        buddhabrot::enabled   = state.buddhabrot;
+        simulation::iteration = state.iteration;
+        data::dataPtr->modifyMagnification(state.magnification);
+
+        auto& set{ *data::dataPtr };
+        if (static_cast<int>(set.getColorMode()) != state.colorMode)
+            set.setColorMode(static_cast<Data_type::ColorMode>(state.colorMode));
+
+        const Data_type::Formula formula{ state.exponent, state.julia, { state.juliaReal, state.juliaImag } };
+        const auto&              current{ set.getFormula() };
+        if (current.exponent != formula.exponent || current.julia != formula.julia || current.juliaC != formula.juliaC)
+            set.setFormula(formula);
+
+        if (set.getAntiAliasing().enabled != state.antiAliasing) {
+            auto antiAliasing{ set.getAntiAliasing() };
+            antiAliasing.enabled = state.antiAliasing;
+            set.setAntiAliasing(antiAliasing);
+        }
+        if (set.isFloatFastPathEnabled() != state.floatFastPath)
+            set.setFloatFastPath(state.floatFastPath);
+    }
+
+    // drives updateStates() through a recorded session without a window, then reports the time of every frame and the
+    // latency from every input to the first complete frame that shows it. the replay clock runs in real time, so the
+    // render budget and the resolution scaling behave as they did live, except that stretches where the image is
+    // complete and nothing happens are skipped
+    int replay(Data_type& data, const std::vector<InputState>& inputs, int iteration, Value_type radius)
+    {
+        if (inputs.empty()) {
+            std::cerr << "The recording is empty\n";
+            return 1;
+        }
+
+        configuration::headless = true;
+        data::dataPtr           = &data;
+        simulation::iteration   = iteration;
+        simulation::radius      = radius;
+        view::speed             = 1.0;
+        replaying::start        = std::chrono::steady_clock::now();
+        replaying::skipped      = inputs.front().time;
+
+        std::vector<double> frameTimes;
+        std::vector<double> latencies;
+        std::vector<double> pending;    // times of the inputs not shown by a complete frame yet
+        std::size_t         next{ 0 };
+
+        while (true) {
+            // every input due by now, as if they had all come in since the last poll
+            while (next < inputs.size() && inputs[next].time <= getTime()) {
+                applyInput(inputs[next]);
+                pending.push_back(inputs[next].time);
+                ++next;
+            }
+
+            util::Timer frameTimer{ "frame", false };
+            updateDeltaTime();
+            updateStates();
+            frameTimes.push_back(frameTimer.elapsed());
+
+            // the orbit density never completes, every frame of it counts as one
+            const bool complete{ buddhabrot::enabled || data.isUpToDate(simulation::currentIteration, simulation::radius) };
+            if (!complete)
+                continue;
+
+            const double now{ getTime() };
+            for (const double time : pending)
+                latencies.push_back((now - time) * 1000.0);
+            pending.clear();
+
+            // skip ahead to the next input, or to when the resolution goes back to native
+            double target{ next < inputs.size() ? inputs[next].time : std::numeric_limits<double>::infinity() };
+            if (resolution::scale < 1.0)
+                target = std::min(target, resolution::lastChange + resolution::idleDelay + 1e-3);
+            if (target == std::numeric_limits<double>::infinity())
+                break;
+            replaying::skipped += std::max(target - now, 0.0);
+        }
+
+        const auto percentile{ [](std::vector<double> values, double p) {
+            if (values.empty())
+                return 0.0;
+            std::sort(values.begin(), values.end());
+            const auto rank{ static_cast<std::size_t>(std::ceil(p * static_cast<double>(values.size()))) };
+            return values[std::clamp<std::size_t>(rank, 1, values.size()) - 1];
+        } };
+        const auto report{ [&](const char* name, const std::vector<double>& values) {
+            std::cout << std::format(
+                "{}: p50 {:.2f} ms | p95 {:.2f} ms | p99 {:.2f} ms | max {:.2f} ms ({} samples)\n",
+                name,
+                percentile(values, 0.50),
+                percentile(values, 0.95),
+                percentile(values, 0.99),
+                percentile(values, 1.00),
+                values.size()
+            );
+        } };
+
+        std::cout << std::format("Replayed {} inputs over {:.2f} s of session in {} frames\n", inputs.size(), inputs.back().time - inputs.front().time, frameTimes.size());
+        report("Frame time   ", frameTimes);
+        report("Input latency", latencies);
+        return 0;
+    }
 }
 
 #endif
@@ -6,8 +6,30 @@ out vec4 FragColor;
 uniform sampler2D tex;
 uniform vec3 color;
 
+// when set, tex holds iteration counts (GL_R16) and is coloured here with the cosine palette
+uniform bool  iterationInput;
+uniform float maxIteration;
+uniform vec3  paletteFrequency;
+uniform float paletteOffset;
+uniform float paletteScale;
+uniform float palettePhase;
+uniform vec3  interiorColor;
+
+vec3 palette(float x)
+{
+    return (1.0f + paletteOffset / 2.0f - (1.0f - paletteOffset) * cos(paletteFrequency * x)) / 2.0f;
+}
+
 void main()
 {
+    if (iterationInput) {
+        // unorm to float is not exact, rounding gets the integer count back
+        float iteration = round(texture(tex, TexCoords).r * 65535.0f);
+        vec3  rgb       = iteration >= maxIteration ? interiorColor : palette(iteration * paletteScale + palettePhase);
+        FragColor = vec4(rgb * color, 1.0f);
+        return;
+    }
+
     // point lights
     vec4 textureColor = texture(tex, TexCoords);
     if (textureColor.a < 0.1f)
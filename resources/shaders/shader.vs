@@ -6,18 +6,15 @@ layout (location = 2) in vec2 aTexCoords;
 
 out vec2 TexCoords;
 
-// uniform mat4 model;
-// uniform mat4 view;
-// uniform mat4 projection;
+// xy scale, zw offset. the quad is drawn once per band of the texture rendered for the same view, placed where that part
+// of the plane is in the current view (pan/zoom preview before the new frame is done)
+uniform vec4 positionTransform;
+uniform vec4 texCoordsTransform;
 
 
 void main()
 {
-    // gl_Position = projection * view * model * vec4(aPos, 1.0);
-    gl_Position = vec4(aPos, 1.0);
+    gl_Position = vec4(aPos.xy * positionTransform.xy + positionTransform.zw, aPos.z, 1.0);
 
-    // remove the effect of wrongly scaling the normal vectors
-    // Normal = mat3(transpose(inverse(model))) * aNormal;
-
-    TexCoords = aTexCoords;
-}
\ No newline at end of file
+    TexCoords = aTexCoords * texCoordsTransform.xy + texCoordsTransform.zw;
+}
@@ -0,0 +1,402 @@
+#ifndef TILE_CACHE_H
+#define TILE_CACHE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#    define TILE_CACHE_MMAP
+#endif
+
+#include "./iteration_codec.h"
+#include "util/channel.hpp"
+
+// store of computed iteration counts, one entry per rendered view, kept compressed (see iteration_codec.h) in memory
+// and on disk. the most recently used entries stay in memory up to maxMemoryBytes, the others are found on disk: a
+// file is a fixed header followed by the encoded counts, mapped and decoded straight from the mapping. files are
+// written to a temporary name and renamed, readers never see half a file. the header holds the length and a checksum
+// of the data, a file failing either is damaged: it is removed and counts as a miss. the least recently used files are
+// removed once the directory grows past maxBytes (hits refresh the modification time)
+//
+// store() only encodes, the file is written and the directory evicted by a writer thread, so storing costs the caller
+// no disk access. the directory is scanned once and then only when the written bytes take it past maxBytes
+//
+// without POSIX mmap only the memory part is there
+class TileCache
+{
+public:
+    // everything the counts depend on, compared bit for bit. the caller decides how exact the values are (the engine
+    // quantizes the position and magnification, see MandelbrotSet::getCacheKey)
+    struct Key
+    {
+        double        xCenter{};
+        double        yCenter{};
+        double        magnification{};
+        double        radius{};
+        std::uint64_t width{};
+        std::uint64_t height{};
+        std::uint64_t iteration{};
+        std::int32_t  exponent{};
+        std::int32_t  flags{};    // Flag bits
+        double        juliaReal{};
+        double        juliaImag{};
+
+        bool operator==(const Key&) const = default;
+    };
+
+    enum Flag : std::int32_t
+    {
+        julia       = 1 << 0,
+        singleFloat = 1 << 1,    // rendered by the float kernel
+    };
+
+    using Data_type = std::shared_ptr<const std::vector<std::uint8_t>>;
+
+    // encoded counts of a hit: a read-only mapping of its file, unmapped on destruction, or the entry kept in memory
+    class Entry
+    {
+    public:
+        Entry(void* mapping, std::size_t size)
+            : m_mapping{ mapping }
+            , m_size{ size }
+        {
+        }
+
+        Entry(Data_type data)
+            : m_data{ std::move(data) }
+        {
+        }
+
+        Entry(Entry&& other) noexcept
+            : m_mapping{ std::exchange(other.m_mapping, nullptr) }
+            , m_size{ std::exchange(other.m_size, 0) }
+            , m_data{ std::move(other.m_data) }
+        {
+        }
+
+        Entry& operator=(Entry&& other) noexcept
+        {
+            std::swap(m_mapping, other.m_mapping);
+            std::swap(m_size, other.m_size);
+            std::swap(m_data, other.m_data);
+            return *this;
+        }
+
+        Entry(const Entry&)            = delete;
+        Entry& operator=(const Entry&) = delete;
+
+        ~Entry()
+        {
+#ifdef TILE_CACHE_MMAP
+            if (m_mapping)
+                ::munmap(m_mapping, m_size);
+#endif
+        }
+
+        std::span<const std::uint8_t> getData() const
+        {
+            if (m_data)
+                return *m_data;
+            return { static_cast<const std::uint8_t*>(m_mapping) + sizeof(Header), m_size - sizeof(Header) };
+        }
+
+        // false when the entry turns out to be corrupt
+        bool getIterations(std::span<std::int32_t> iterations) const
+        {
+            return iterationCodec::decode(getData(), iterations);
+        }
+
+    private:
+        void*       m_mapping{};
+        std::size_t m_size{};
+        Data_type   m_data{};
+    };
+
+private:
+    static constexpr std::uint32_t s_magic{ 0x4d425443 };    // "CTBM"
+    static constexpr std::uint32_t s_version{ 4 };
+    static constexpr std::size_t   s_pendingFiles{ 8 };    // stores past this many waiting files only go to memory
+
+    // padded to a multiple of 64 bytes, the data behind it starts cache line aligned
+    struct alignas(64) Header
+    {
+        std::uint32_t magic{ s_magic };
+        std::uint32_t version{ s_version };
+        Key           key{};
+        std::uint64_t dataSize{};
+        std::uint64_t checksum{};    // getChecksum() of the data
+    };
+
+    std::filesystem::path      m_directory{};
+    std::uintmax_t             m_maxBytes{};
+    std::mutex                 m_mutex{};            // serializes eviction
+    std::atomic<std::uint64_t> m_temporaryCount{};    // unique temporary names for concurrent stores
+    std::uintmax_t             m_diskBytes{};         // size of the directory as of the last scan plus what was written since
+    bool                       m_diskScanned{};
+
+    // entries kept in memory, most recently used first
+    std::list<std::pair<Key, Data_type>> m_memory{};
+    std::size_t                          m_memoryBytes{};
+    std::size_t                          m_maxMemoryBytes{};
+    mutable std::mutex                   m_memoryMutex{};
+
+    // files waiting for the writer thread, started last
+    util::Channel<std::pair<Key, Data_type>> m_pending{ s_pendingFiles };
+    std::thread                              m_writer{};
+
+public:
+    TileCache(std::filesystem::path directory, std::uintmax_t maxBytes = 512ull * 1024 * 1024, std::size_t maxMemoryBytes = 64ull * 1024 * 1024)
+        : m_directory{ std::move(directory) }
+        , m_maxBytes{ maxBytes }
+        , m_maxMemoryBytes{ maxMemoryBytes }
+    {
+        std::error_code error;
+        std::filesystem::create_directories(m_directory, error);
+#ifdef TILE_CACHE_MMAP
+        m_writer = std::thread{ [this] {
+            while (auto file{ m_pending.pop() })
+                writeFile(file->first, *file->second);
+        } };
+#endif
+    }
+
+    TileCache(const TileCache&)            = delete;
+    TileCache& operator=(const TileCache&) = delete;
+
+    // the files still waiting are written first
+    ~TileCache()
+    {
+        m_pending.close();
+        if (m_writer.joinable())
+            m_writer.join();
+    }
+
+    // $XDG_CACHE_HOME/mandelbrot-set or ~/.cache/mandelbrot-set, nothing when neither is set
+    static std::optional<std::filesystem::path> getDefaultDirectory()
+    {
+        if (const char* cache{ std::getenv("XDG_CACHE_HOME") }; cache && *cache)
+            return std::filesystem::path{ cache } / "mandelbrot-set";
+        if (const char* home{ std::getenv("HOME") }; home && *home)
+            return std::filesystem::path{ home } / ".cache" / "mandelbrot-set";
+        return std::nullopt;
+    }
+
+    std::optional<Entry> find(const Key& key, std::size_t length)
+    {
+        if (auto data{ findInMemory(key) }) {
+            if (iterationCodec::getCount(*data) != length)
+                return std::nullopt;
+            return Entry{ std::move(data) };
+        }
+
+#ifdef TILE_CACHE_MMAP
+        const auto  path{ getPath(key) };
+        const int   file{ ::open(path.c_str(), O_RDONLY) };
+        struct stat status{};
+        if (file < 0)
+            return std::nullopt;
+        if (::fstat(file, &status) != 0 || static_cast<std::size_t>(status.st_size) <= sizeof(Header)) {
+            ::close(file);
+            return std::nullopt;
+        }
+
+        void* mapping{ ::mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_SHARED, file, 0) };
+        ::close(file);
+        if (mapping == MAP_FAILED)
+            return std::nullopt;
+
+        // hash collisions and files of another version are plain misses
+        Entry         entry{ mapping, static_cast<std::size_t>(status.st_size) };
+        const Header& header{ *static_cast<const Header*>(mapping) };
+        if (header.magic != s_magic || header.version != s_version || !(header.key == key))
+            return std::nullopt;
+
+        // damaged files go, before anything is decoded from them
+        std::error_code error;
+        if (header.dataSize != entry.getData().size() || header.checksum != getChecksum(entry.getData())
+            || iterationCodec::getCount(entry.getData()) != length) {
+            std::filesystem::remove(path, error);
+            return std::nullopt;
+        }
+
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+
+        // the next hit won't need the file
+        const auto data{ entry.getData() };
+        storeInMemory(key, std::make_shared<const std::vector<std::uint8_t>>(data.begin(), data.end()));
+        return entry;
+#else
+        return std::nullopt;
+#endif
+    }
+
+    // an entry still in memory (e.g. a view loaded from the cache) is already stored, only its use is refreshed
+    void store(const Key& key, std::span<const std::int32_t> iterations)
+    {
+        if (findInMemory(key))
+            return;
+
+        auto data{ std::make_shared<const std::vector<std::uint8_t>>(iterationCodec::encode(iterations)) };
+        storeInMemory(key, data);
+#ifdef TILE_CACHE_MMAP
+        m_pending.tryPush({ key, std::move(data) });
+#endif
+    }
+
+    // remove the least recently used entries until the directory fits in maxBytes
+    void evict()
+    {
+        std::lock_guard lock{ m_mutex };
+        m_diskScanned = true;
+
+        std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::directory_entry>> entries;
+        std::uintmax_t                                                                            total{ 0 };
+
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator{ m_directory, error }) {
+            if (entry.path().extension() != ".tile")
+                continue;
+            total += entry.file_size(error);
+            entries.emplace_back(entry.last_write_time(error), entry);
+        }
+        m_diskBytes = total;
+        if (total <= m_maxBytes)
+            return;
+
+        std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        for (const auto& [time, entry] : entries) {
+            if (total <= m_maxBytes)
+                break;
+            total -= entry.file_size(error);
+            std::filesystem::remove(entry.path(), error);    // a reader that has it mapped keeps its pages
+        }
+        m_diskBytes = total;
+    }
+
+    const std::filesystem::path& getDirectory() const { return m_directory; }
+
+    // encoded size of the entries in memory
+    std::size_t getMemoryBytes() const
+    {
+        std::lock_guard lock{ m_memoryMutex };
+        return m_memoryBytes;
+    }
+
+private:
+    // on the writer thread
+    void writeFile(const Key& key, const std::vector<std::uint8_t>& data)
+    {
+#ifdef TILE_CACHE_MMAP
+        const auto path{ getPath(key) };
+        auto       temporary{ path };
+        temporary += std::format(".{}.{}.tmp", ::getpid(), m_temporaryCount++);
+
+        bool written{};
+        {
+            std::ofstream file{ temporary, std::ios::binary | std::ios::trunc };
+            const Header  header{ .key = key, .dataSize = data.size(), .checksum = getChecksum(data) };
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+            written = static_cast<bool>(file);
+        }
+
+        std::error_code error;
+        if (written)
+            std::filesystem::rename(temporary, path, error);
+        if (!written || error) {
+            std::filesystem::remove(temporary, error);
+            return;
+        }
+
+        bool full;
+        {
+            std::lock_guard lock{ m_mutex };
+            m_diskBytes += sizeof(Header) + data.size();    // an overwritten file is counted twice until the next scan
+            full         = !m_diskScanned || m_diskBytes > m_maxBytes;
+        }
+        if (full)
+            evict();
+#else
+        (void)key;
+        (void)data;
+#endif
+    }
+
+    Data_type findInMemory(const Key& key)
+    {
+        std::lock_guard lock{ m_memoryMutex };
+        const auto      found{ std::find_if(m_memory.begin(), m_memory.end(), [&key](const auto& entry) { return entry.first == key; }) };
+        if (found == m_memory.end())
+            return nullptr;
+        m_memory.splice(m_memory.begin(), m_memory, found);
+        return found->second;
+    }
+
+    // least recently used entries are dropped past maxMemoryBytes, an entry larger than that is not kept at all
+    void storeInMemory(const Key& key, Data_type data)
+    {
+        std::lock_guard lock{ m_memoryMutex };
+        if (data->size() > m_maxMemoryBytes)
+            return;
+
+        const auto found{ std::find_if(m_memory.begin(), m_memory.end(), [&key](const auto& entry) { return entry.first == key; }) };
+        if (found != m_memory.end()) {
+            m_memoryBytes -= found->second->size();
+            m_memory.erase(found);
+        }
+        m_memoryBytes += data->size();
+        m_memory.emplace_front(key, std::move(data));
+
+        while (m_memoryBytes > m_maxMemoryBytes) {
+            m_memoryBytes -= m_memory.back().second->size();
+            m_memory.pop_back();
+        }
+    }
+
+    // FNV-1a over 8 byte words (then the remaining bytes), fast enough to check every file read
+    static std::uint64_t getChecksum(std::span<const std::uint8_t> data)
+    {
+        constexpr std::uint64_t prime{ 0x100000001b3ull };
+        std::uint64_t           hash{ 0xcbf29ce484222325ull };
+        std::size_t             i{ 0 };
+        for (; i + sizeof(std::uint64_t) <= data.size(); i += sizeof(std::uint64_t)) {
+            std::uint64_t word;
+            std::memcpy(&word, data.data() + i, sizeof(word));
+            hash = (hash ^ word) * prime;
+        }
+        for (; i < data.size(); ++i)
+            hash = (hash ^ data[i]) * prime;
+        return hash;
+    }
+
+    std::filesystem::path getPath(const Key& key) const
+    {
+        // FNV-1a over the key bytes (no padding in Key)
+        std::uint64_t hash{ 0xcbf29ce484222325ull };
+        const auto*   bytes{ reinterpret_cast<const unsigned char*>(&key) };
+        for (std::size_t i{ 0 }; i < sizeof(Key); ++i)
+            hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+        return m_directory / std::format("{:016x}.tile", hash);
+    }
+};
+
+#endif /* ifndef TILE_CACHE_H */
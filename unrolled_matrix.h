@@ -6,18 +6,29 @@
 #include <functional>
 #include <algorithm>
 #include <iostream>
-#include <execution>
+#include <span>
+#include <stdexcept>
 
-#include "util/timer.hpp"
+#include "./matrix_layout.h"
+#include "./matrix_view.h"
+#include "util/aligned_allocator.hpp"
 
-template <typename T>
+// Layout decides the storage order (see matrix_layout.h). data() and base() expose the storage as is, which is only
+// row-major (and getLength() long) for layout::RowMajor; the other layouts go through tiles() or copyToRowMajor().
+// view() hands the storage to MatrixView, which runs the passes
+template <typename T, typename Layout = layout::RowMajor<>>
 class UnrolledMatrix
 {
 public:
-    using Element_type = T;
+    using Element_type   = T;
+    using Layout_type    = Layout;
+    using Container_type = util::AlignedVector<Element_type>;    // elements are default-initialized, not zero-filled
+
+    using View_type      = MatrixView<Element_type, Layout>;
+    using ConstView_type = MatrixView<const Element_type, Layout>;
 
 private:
-    std::vector<Element_type> m_mat{};
+    Container_type m_mat{};
 
     std::size_t m_width{};
     std::size_t m_height{};
@@ -29,18 +40,18 @@ public:
         std::size_t width,
         std::size_t height
     )
-        : m_mat{ std::vector<Element_type>(width * height) }
+        : m_mat(Layout::getStorageSize(width, height))
         , m_width{ width }
         , m_height{ height }
     {
     }
 
     UnrolledMatrix(
-        std::vector<Element_type>&& mat,
-        std::size_t                 width,
-        std::size_t                 height
+        Container_type&& mat,
+        std::size_t      width,
+        std::size_t      height
     )
-        : m_mat{ mat }
+        : m_mat{ std::move(mat) }
         , m_width{ width }
         , m_height{ height }
     {
@@ -48,28 +59,44 @@ public:
 
     ~UnrolledMatrix() = default;
 
-    void apply(std::function<Element_type(Element_type&)> func)
+    // keeps the allocation when shrinking. the content is not preserved: when growing past the capacity the old
+    // elements are dropped instead of being copied over, and new elements are left uninitialized (trivial types)
+    void resize(std::size_t width, std::size_t height)
+    {
+        const std::size_t length{ Layout::getStorageSize(width, height) };
+        if (length > m_mat.capacity()) {
+            m_mat.clear();
+            m_mat.reserve(length);
+        }
+        m_mat.resize(length);
+        m_width  = width;
+        m_height = height;
+    }
+
+    // the parallel passes of MatrixView over the whole matrix
+
+    template <typename Func>
+    void map(Func&& func)
+    {
+        view().map(std::forward<Func>(func));
+    }
+
+    template <typename U, typename Func>
+    void zip(const UnrolledMatrix<U, Layout>& other, Func&& func)
     {
-        std::transform(std::execution::par_unseq, m_mat.begin(), m_mat.end(), m_mat.begin(), func);
-        // for (auto& element: m_mat)
-        //{
-        //     func(element);
-        // }
+        view().zip(other.view(), std::forward<Func>(func));
     }
 
-    template <typename T_other>
-    void apply(UnrolledMatrix<T_other>& mat_other, std::function<Element_type(Element_type&, T_other&)> func)
+    template <typename R, typename Func, typename Combine = std::plus<>>
+    R reduce(R identity, Func&& func, Combine&& combine = {}) const
     {
-        util::Timer timer{ "apply on matrix" };
-        auto [width, height]{ mat_other.getSize() };
-        std::transform(std::execution::par_unseq, m_mat.begin(), m_mat.end(), mat_other.base().begin(), m_mat.begin(), func);
-        // for (std::size_t y{ 0 }; y < height; ++y)
-        //{
-        //     for (std::size_t x{ 0 }; x < width; ++x)
-        //     {
-        //         func(this->getElement(x,y), mat_other.getElement(x,y));
-        //     }
-        // }
+        return view().reduce(identity, std::forward<Func>(func), std::forward<Combine>(combine));
+    }
+
+    template <typename U, typename SourceLayout, typename Func>
+    void stencil(const UnrolledMatrix<U, SourceLayout>& source, Func&& func)
+    {
+        view().stencil(source.view(), std::forward<Func>(func));
     }
 
     Element_type& getElement(std::size_t col, std::size_t row)
@@ -77,8 +104,7 @@ public:
         if (col < 0 || row < 0 || col >= m_width || row >= m_height)
             throw std::range_error{ "out of bound" };
 
-        std::size_t idx{ row * m_width + col };
-        return m_mat[idx];
+        return m_mat[Layout::getIndex(col, row, m_width, m_height)];
     }
 
     const Element_type& getElement(std::size_t col, std::size_t row) const
@@ -86,8 +112,7 @@ public:
         if (col < 0 || row < 0 || col >= m_width || row >= m_height)
             throw std::range_error{ "out of bound" };
 
-        std::size_t idx{ row * m_width + col };
-        return m_mat[idx];
+        return m_mat[Layout::getIndex(col, row, m_width, m_height)];
     }
 
     Element_type&       operator()(std::size_t col, std::size_t row) { return getElement(col, row); }
@@ -98,8 +123,26 @@ public:
 
     std::size_t getLength() const { return m_width * m_height; }
 
+    std::size_t getStorageSize() const { return m_mat.size(); }
+
     const auto& data() const { return m_mat; }
     auto&       base() { return m_mat; }
+    const auto& base() const { return m_mat; }
+
+    View_type      view() { return { m_mat, m_width, m_height }; }
+    ConstView_type view() const { return { m_mat, m_width, m_height }; }
+
+    std::size_t getTileCount() const { return Layout::getTileCount(m_width, m_height); }
+
+    auto getTile(std::size_t index) { return view().getTile(index); }
+    auto getTile(std::size_t index) const { return view().getTile(index); }
+
+    // for (auto tile : matrix.tiles()) ..., tiles come in storage order
+    auto tiles() { return view().tiles(); }
+    auto tiles() const { return view().tiles(); }
+
+    // row-major copy of the matrix (e.g. for upload), out must hold getLength() elements
+    void copyToRowMajor(std::span<Element_type> out) const { view().copyToRowMajor(out); }
 
     friend std::ostream& operator<<(std::ostream& out, const UnrolledMatrix& grid)
     {